@@ -0,0 +1,253 @@
+/**
+ * LSO Project - Forza 4
+ *
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#define _GNU_SOURCE             // memmem
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+
+// ==============================
+// BROADCAST LATENCY BENCHMARK
+// ==============================
+//
+// Logs a crowd of text clients in to a running server, then has the
+// first one create a game: the time from its 'create' to the notice of
+// the new game reaching each of the others is the latency of a broadcast
+// to all of them. The creator leaves the game again between rounds,
+// which broadcasts nothing
+//
+// usage: bench_broadcast [-c clients] [-n rounds] [host] port
+
+#define LOGIN_MARK "[OK] Welcome"
+#define CREATED_MARK "created game #"
+#define MARK_MAX 32
+#define LOGIN_BATCH 256
+#define QUIET_MS 300                   // without data: nothing more is coming
+#define PHASE_TIMEOUT_MS (60 * 1000)
+#define READ_SIZE 65536
+
+typedef struct BenchClient {
+    int socket;
+    int seen;                   // mark found since the last reset
+    char tail[MARK_MAX];        // end of the data read, for a mark split between reads
+    size_t tail_len;
+} BenchClient;
+
+static BenchClient *clients;
+static int client_total;
+static int epoll_fd;
+
+static long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+/**
+ * Look for a mark in what a client just received, and keep the end of
+ * it in case the next read completes a mark
+ */
+static void client_scan(BenchClient *c, const char *data, size_t len, const char *mark) {
+    static char window[MARK_MAX + READ_SIZE];
+    size_t mark_len = strlen(mark);
+    
+    memcpy(window, c->tail, c->tail_len);
+    memcpy(window + c->tail_len, data, len);
+    size_t total = c->tail_len + len;
+    
+    if (memmem(window, total, mark, mark_len)) c->seen = 1;
+    
+    c->tail_len = total < mark_len - 1 ? total : mark_len - 1;
+    memcpy(c->tail, window + total - c->tail_len, c->tail_len);
+}
+
+static void clients_reset(void) {
+    for (int i = 0; i < client_total; i++) {
+        clients[i].seen = 0;
+        clients[i].tail_len = 0;
+    }
+}
+
+/**
+ * Read whatever the server sent, until `wanted` clients (the first one
+ * excluded if skip_first) have received the mark, recording when each
+ * of them did in arrivals[]
+ * With no mark, read until the server stays quiet for QUIET_MS
+ * Returns 0, -1 on timeout or a closed connection
+ */
+static int pump(const char *mark, int wanted, int skip_first, long start, long *arrivals) {
+    struct epoll_event events[256];
+    static char data[READ_SIZE];
+    long deadline = now_ns() + PHASE_TIMEOUT_MS * 1000000L;
+    int done = 0;
+    
+    while (mark ? done < wanted : 1) {
+        int n = epoll_wait(epoll_fd, events, 256, mark ? 100 : QUIET_MS);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0 && !mark) return 0;
+        if (now_ns() > deadline) return -1;
+    
+        for (int i = 0; i < n; i++) {
+            BenchClient *c = events[i].data.ptr;
+            ssize_t len;
+            while ((len = recv(c->socket, data, sizeof(data), 0)) > 0) {
+                if (!mark || c->seen) continue;
+                client_scan(c, data, len, mark);
+                if (c->seen && !(skip_first && c == &clients[0])) {
+                    if (arrivals) arrivals[done] = now_ns() - start;
+                    done++;
+                }
+            }
+            if (len == 0 || (len < 0 && errno != EAGAIN)) {
+                fprintf(stderr, "connection %ld closed by the server\n", (long)(c - clients));
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static int send_line(BenchClient *c, const char *line) {
+    size_t len = strlen(line);
+    return send(c->socket, line, len, MSG_NOSIGNAL) == (ssize_t)len ? 0 : -1;
+}
+
+/**
+ * Connect and log in every client, a batch at a time, reading the
+ * notices of the earlier logins meanwhile
+ */
+static int clients_login(const struct addrinfo *addr) {
+    char line[64];
+    
+    for (int start = 0; start < client_total; start += LOGIN_BATCH) {
+        int end = start + LOGIN_BATCH < client_total ? start + LOGIN_BATCH : client_total;
+    
+        for (int i = start; i < end; i++) {
+            BenchClient *c = &clients[i];
+            c->socket = socket(addr->ai_family, SOCK_STREAM, 0);
+            if (c->socket < 0 || connect(c->socket, addr->ai_addr, addr->ai_addrlen) < 0) {
+                perror("connect");
+                return -1;
+            }
+            fcntl(c->socket, F_SETFL, fcntl(c->socket, F_GETFL) | O_NONBLOCK);
+    
+            struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, c->socket, &ev);
+    
+            snprintf(line, sizeof(line), "bench%d\n", i);
+            if (send_line(c, line) < 0) {
+                perror("send");
+                return -1;
+            }
+        }
+    
+        clients_reset();
+        if (pump(LOGIN_MARK, end - start, 0, 0, NULL) < 0) {
+            fprintf(stderr, "login of clients %d-%d failed\n", start, end - 1);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int compare_long(const void *a, const void *b) {
+    long x = *(const long *)a, y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-c clients] [-n rounds] [host] port\n", prog);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    int rounds = 20;
+    const char *host = "127.0.0.1";
+    const char *port = NULL;
+    int opt;
+    
+    client_total = 10000;
+    while ((opt = getopt(argc, argv, "c:n:")) != -1) {
+        switch (opt) {
+            case 'c': client_total = atoi(optarg); break;
+            case 'n': rounds = atoi(optarg); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (optind == argc - 2) host = argv[optind++];
+    if (optind != argc - 1 || client_total < 2 || rounds < 1) usage(argv[0]);
+    port = argv[optind];
+    
+    // One descriptor per client, and a few more
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < (rlim_t)client_total + 16) {
+        fprintf(stderr, "%d clients need %d descriptors, the limit is %lu (ulimit -n)\n",
+                client_total, client_total + 16, (unsigned long)limit.rlim_cur);
+        return 1;
+    }
+    
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *addr;
+    if (getaddrinfo(host, port, &hints, &addr) != 0) {
+        fprintf(stderr, "cannot resolve %s:%s\n", host, port);
+        return 1;
+    }
+    
+    clients = calloc(client_total, sizeof(BenchClient));
+    long *arrivals = malloc(client_total * sizeof(long));
+    long *lasts = malloc(rounds * sizeof(long));
+    epoll_fd = epoll_create1(0);
+    
+    long login_start = now_ns();
+    if (clients_login(addr) < 0) return 1;
+    printf("%d clients logged in, %.2f s\n", client_total, (now_ns() - login_start) / 1e9);
+    
+    int others = client_total - 1;
+    printf("%6s %12s %12s %12s %12s\n", "round", "first us", "median us", "p99 us", "last us");
+    for (int r = 0; r < rounds; r++) {
+        pump(NULL, 0, 0, 0, NULL);
+        clients_reset();
+    
+        long start = now_ns();
+        if (send_line(&clients[0], "create\n") < 0 ||
+            pump(CREATED_MARK, others, 1, start, arrivals) < 0) {
+            fprintf(stderr, "round %d: the notice did not reach every client\n", r + 1);
+            return 1;
+        }
+        qsort(arrivals, others, sizeof(long), compare_long);
+        lasts[r] = arrivals[others - 1];
+        printf("%6d %12.1f %12.1f %12.1f %12.1f\n", r + 1,
+               arrivals[0] / 1e3, arrivals[others / 2] / 1e3,
+               arrivals[(long)others * 99 / 100] / 1e3, lasts[r] / 1e3);
+    
+        if (send_line(&clients[0], "leave\n") < 0) {
+            perror("send");
+            return 1;
+        }
+    }
+    
+    qsort(lasts, rounds, sizeof(long), compare_long);
+    printf("broadcast to %d clients: median %.1f us, best %.1f us, worst %.1f us\n",
+           others, lasts[rounds / 2] / 1e3, lasts[0] / 1e3, lasts[rounds - 1] / 1e3);
+    
+    freeaddrinfo(addr);
+    return 0;
+}
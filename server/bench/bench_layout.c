@@ -0,0 +1,235 @@
+/**
+ * LSO Project - Forza 4
+ *
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#include "../server.h"
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+// ==============================
+// GAME LAYOUT BENCHMARK
+// ==============================
+//
+// Threads play moves concurrently, each on its own game of an array,
+// writing it the way make_move does. The first run keeps the fields of a
+// move packed one game after the other, as Game did before it was split
+// across cache lines, so that neighbouring games share lines; the second
+// uses the server's Game. The CPU's cache miss counters, when the kernel
+// lets a process read them, show what the shared lines cost
+//
+// usage: bench_layout [-t threads] [-n moves per thread]
+
+// The fields of a move, with nothing to keep games on separate lines
+typedef struct PackedGame {
+    int id;
+    Board board;
+    GameState state;
+    int creator_id;
+    int opponent_id;
+    int current_turn;
+    int winner_id;
+    int is_active;
+    unsigned seq;
+    unsigned long turn_started;
+} PackedGame;
+
+typedef struct Player {
+    void *games;
+    int index;                  // its game in games
+    long moves;
+    pthread_barrier_t *start;
+} Player;
+
+typedef struct Counter {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+    int fd;                     // -1: not available
+} Counter;
+
+static Counter counters[] = {
+    { "L1d misses", PERF_TYPE_HW_CACHE,
+      PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), -1 },
+    { "cache misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, -1 },
+};
+static const int counter_count = sizeof(counters) / sizeof(counters[0]);
+
+static long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+// A game thread: the moves of make_move under the game's seq, the turn
+// timestamp of handle_move, and a new game whenever one ends
+#define LAYOUT_PLAYER(TYPE)                                                     \
+static void *play_##TYPE(void *arg) {                                           \
+    Player *p = arg;                                                            \
+    TYPE *game = &((TYPE *)p->games)[p->index];                                 \
+    int cols = board_variant(&game->board)->cols;                               \
+    unsigned rng = p->index * 2654435761u + 1;                                  \
+                                                                                \
+    pthread_barrier_wait(p->start);                                             \
+    for (long m = 0; m < p->moves; m++) {                                       \
+        int player = game->current_turn;                                        \
+        int side = player == game->creator_id ? 0 : 1;                          \
+        rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;                    \
+        int col = rng % cols;                                                   \
+                                                                                \
+        __atomic_store_n(&game->seq, game->seq + 1, __ATOMIC_RELAXED);          \
+        __atomic_thread_fence(__ATOMIC_RELEASE);                                \
+        while (board_play(&game->board, col, side) < 0) {                       \
+            col = (col + 1) % cols;                                             \
+        }                                                                       \
+        if (board_wins(&game->board, side) || board_full(&game->board)) {       \
+            game->winner_id = player;                                           \
+            game->state = GAME_FINISHED;                                        \
+        } else {                                                                \
+            game->current_turn = side ? game->creator_id : game->opponent_id;   \
+        }                                                                       \
+        __atomic_store_n(&game->seq, game->seq + 1, __ATOMIC_RELEASE);          \
+        __atomic_store_n(&game->turn_started, m, __ATOMIC_RELAXED);             \
+                                                                                \
+        if (game->state == GAME_FINISHED) {                                     \
+            __atomic_store_n(&game->seq, game->seq + 1, __ATOMIC_RELAXED);      \
+            __atomic_thread_fence(__ATOMIC_RELEASE);                            \
+            board_init(&game->board, 0);                                        \
+            game->state = GAME_IN_PROGRESS;                                     \
+            game->current_turn = game->creator_id;                              \
+            game->winner_id = 0;                                                \
+            __atomic_store_n(&game->seq, game->seq + 1, __ATOMIC_RELEASE);      \
+        }                                                                       \
+    }                                                                           \
+    return NULL;                                                                \
+}                                                                               \
+                                                                                \
+static void *games_##TYPE(int count) {                                          \
+    TYPE *games = aligned_alloc(CACHE_LINE,                                     \
+        (count * sizeof(TYPE) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE);     \
+    if (!games) return NULL;                                                    \
+    memset(games, 0, count * sizeof(TYPE));                                     \
+    for (int i = 0; i < count; i++) {                                           \
+        games[i].id = i;                                                        \
+        board_init(&games[i].board, 0);                                         \
+        games[i].state = GAME_IN_PROGRESS;                                      \
+        games[i].creator_id = 2 * i;                                            \
+        games[i].opponent_id = 2 * i + 1;                                       \
+        games[i].current_turn = 2 * i;                                          \
+        games[i].is_active = 1;                                                 \
+    }                                                                           \
+    return games;                                                               \
+}
+
+LAYOUT_PLAYER(PackedGame)
+LAYOUT_PLAYER(Game)
+
+/**
+ * Open the cache miss counters, for this thread and the ones it starts
+ */
+static void counters_open(void) {
+    for (int i = 0; i < counter_count; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = counters[i].type;
+        attr.config = counters[i].config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        counters[i].fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+}
+
+/**
+ * Play `moves` moves on each of `threads` neighbouring games, and print
+ * the time it took and the cache misses counted meanwhile
+ */
+static int run(const char *name, size_t size, void *(*alloc)(int), void *(*play)(void *),
+               int threads, long moves) {
+    void *games = alloc(threads);
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    Player *players = malloc(threads * sizeof(Player));
+    pthread_barrier_t start;
+    if (!games || !tids || !players) {
+        fprintf(stderr, "out of memory\n");
+        return -1;
+    }
+    pthread_barrier_init(&start, NULL, threads + 1);
+    
+    for (int i = 0; i < counter_count; i++) {
+        if (counters[i].fd < 0) continue;
+        ioctl(counters[i].fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counters[i].fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    for (int i = 0; i < threads; i++) {
+        players[i] = (Player){ games, i, moves, &start };
+        pthread_create(&tids[i], NULL, play, &players[i]);
+    }
+    pthread_barrier_wait(&start);
+    long begin = now_ns();
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    long elapsed = now_ns() - begin;
+    
+    printf("%-8s %6zu %10.1f %9.1f", name, size, elapsed / 1e6,
+           (double)elapsed / moves);
+    for (int i = 0; i < counter_count; i++) {
+        uint64_t value;
+        if (counters[i].fd >= 0) {
+            ioctl(counters[i].fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+        if (counters[i].fd >= 0 && read(counters[i].fd, &value, sizeof(value)) == sizeof(value)) {
+            printf(" %14llu", (unsigned long long)value);
+        } else {
+            printf(" %14s", "n/a");
+        }
+    }
+    printf("\n");
+    
+    pthread_barrier_destroy(&start);
+    free(players);
+    free(tids);
+    free(games);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int threads = 32;
+    long moves = 1000000;
+    int opt;
+    
+    while ((opt = getopt(argc, argv, "t:n:")) != -1) {
+        switch (opt) {
+            case 't': threads = atoi(optarg); break;
+            case 'n': moves = atol(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-t threads] [-n moves per thread]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (threads < 1 || moves < 1) {
+        fprintf(stderr, "threads and moves must be positive\n");
+        return 1;
+    }
+    
+    counters_open();
+    printf("%d threads, %ld moves each, %ld CPUs\n", threads, moves, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%-8s %6s %10s %9s", "layout", "bytes", "time ms", "ns/move");
+    for (int i = 0; i < counter_count; i++) {
+        printf(" %14s", counters[i].name);
+    }
+    printf("\n");
+    
+    if (run("packed", sizeof(PackedGame), games_PackedGame, play_PackedGame, threads, moves) < 0 ||
+        run("server", sizeof(Game), games_Game, play_Game, threads, moves) < 0) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,220 @@
+/**
+ * LSO Project - Forza 4
+ *
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#include "../server.h"
+
+// ==============================
+// MOVE LATENCY BENCHMARK
+// ==============================
+//
+// Plays the same stream of random moves on the classic board three ways:
+// the original grid of chars scanned whole for a winner after every
+// move, the bitboards scanned whole, as make_move does, and the
+// bitboards checked only around the last move. Every way must end the
+// same games with the same winners, which the bench checks. Each way runs
+// BENCH_RUNS times, and the fastest run is reported
+//
+// usage: bench_move [-n moves]
+
+#define CLASSIC_ROWS 6
+#define CLASSIC_COLS 7
+#define BENCH_RUNS 5
+
+typedef struct Method {
+    const char *name;
+    long (*play)(long moves, long *wins);
+} Method;
+
+static long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static unsigned next_column(unsigned *rng) {
+    *rng ^= *rng << 13; *rng ^= *rng >> 17; *rng ^= *rng << 5;
+    return *rng % CLASSIC_COLS;
+}
+
+// ==============================
+// CHAR GRID, FULL SCAN
+// ==============================
+
+static int grid_drop(char grid[CLASSIC_ROWS][CLASSIC_COLS], int col, char piece) {
+    for (int r = CLASSIC_ROWS - 1; r >= 0; r--) {
+        if (grid[r][col] == EMPTY) {
+            grid[r][col] = piece;
+            return r;
+        }
+    }
+    return -1;
+}
+
+static int grid_direction(char grid[CLASSIC_ROWS][CLASSIC_COLS], int row, int col,
+                          int dr, int dc, char piece) {
+    int count = 0;
+    for (int i = 0; i < 4; i++) {
+        int r = row + i * dr;
+        int c = col + i * dc;
+        if (r < 0 || r >= CLASSIC_ROWS || c < 0 || c >= CLASSIC_COLS) break;
+        if (grid[r][c] == piece) count++;
+        else break;
+    }
+    return count >= 4;
+}
+
+static int grid_winner(char grid[CLASSIC_ROWS][CLASSIC_COLS], char piece) {
+    for (int r = 0; r < CLASSIC_ROWS; r++) {
+        for (int c = 0; c < CLASSIC_COLS; c++) {
+            if (grid_direction(grid, r, c, 0, 1, piece)) return 1;
+            if (grid_direction(grid, r, c, 1, 0, piece)) return 1;
+            if (grid_direction(grid, r, c, 1, 1, piece)) return 1;
+            if (grid_direction(grid, r, c, 1, -1, piece)) return 1;
+        }
+    }
+    return 0;
+}
+
+static int grid_full(char grid[CLASSIC_ROWS][CLASSIC_COLS]) {
+    for (int c = 0; c < CLASSIC_COLS; c++) {
+        if (grid[0][c] == EMPTY) return 0;
+    }
+    return 1;
+}
+
+/**
+ * Play moves, counting the games won into wins[0] and wins[1]
+ * Returns the games played to the end
+ */
+static long play_grid_scan(long moves, long *wins) {
+    char grid[CLASSIC_ROWS][CLASSIC_COLS];
+    unsigned rng = 1;
+    int side = 0;
+    long games = 0;
+    
+    memset(grid, EMPTY, sizeof(grid));
+    for (long m = 0; m < moves; m++) {
+        char piece = side ? PLAYER2 : PLAYER1;
+        int col = next_column(&rng);
+        while (grid_drop(grid, col, piece) < 0) col = (col + 1) % CLASSIC_COLS;
+    
+        if (grid_winner(grid, piece)) {
+            wins[side]++;
+        } else if (!grid_full(grid)) {
+            side = !side;
+            continue;
+        }
+        games++;
+        memset(grid, EMPTY, sizeof(grid));
+        side = 0;
+    }
+    return games;
+}
+
+// ==============================
+// BITBOARDS
+// ==============================
+
+static long play_board_scan(long moves, long *wins) {
+    Board board;
+    unsigned rng = 1;
+    int side = 0;
+    long games = 0;
+    
+    board_init(&board, 0);
+    for (long m = 0; m < moves; m++) {
+        int col = next_column(&rng);
+        while (board_play(&board, col, side) < 0) col = (col + 1) % CLASSIC_COLS;
+    
+        if (board_wins(&board, side)) {
+            wins[side]++;
+        } else if (!board_full(&board)) {
+            side = !side;
+            continue;
+        }
+        games++;
+        board_init(&board, 0);
+        side = 0;
+    }
+    return games;
+}
+
+static long play_last_move(long moves, long *wins) {
+    Board board;
+    unsigned rng = 1;
+    int side = 0;
+    long games = 0;
+    
+    board_init(&board, 0);
+    for (long m = 0; m < moves; m++) {
+        int col = next_column(&rng);
+        int row;
+        while ((row = board_play(&board, col, side)) < 0) col = (col + 1) % CLASSIC_COLS;
+    
+        if (board_wins_at(&board, col, row)) {
+            wins[side]++;
+        } else if (!board_full(&board)) {
+            side = !side;
+            continue;
+        }
+        games++;
+        board_init(&board, 0);
+        side = 0;
+    }
+    return games;
+}
+
+static const Method methods[] = {
+    { "char grid, full scan", play_grid_scan },
+    { "bitboard, full scan", play_board_scan },
+    { "bitboard, last move", play_last_move },
+};
+static const int method_count = sizeof(methods) / sizeof(methods[0]);
+
+int main(int argc, char *argv[]) {
+    long moves = 10000000;
+    long first_games = 0, first_wins[2] = { 0, 0 };
+    int opt;
+    
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+            case 'n': moves = atol(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-n moves]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (moves < 1) {
+        fprintf(stderr, "moves must be positive\n");
+        return 1;
+    }
+    
+    printf("%ld moves on the %s board, best of %d runs\n", moves, variants[0].name, BENCH_RUNS);
+    printf("%-22s %10s %9s %10s\n", "win check", "time ms", "ns/move", "games");
+    for (int i = 0; i < method_count; i++) {
+        long wins[2], games = 0, elapsed = 0;
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            wins[0] = wins[1] = 0;
+            long start = now_ns();
+            games = methods[i].play(moves, wins);
+            long time = now_ns() - start;
+            if (run == 0 || time < elapsed) elapsed = time;
+        }
+    
+        printf("%-22s %10.1f %9.2f %10ld\n", methods[i].name,
+               elapsed / 1e6, (double)elapsed / moves, games);
+        if (i == 0) {
+            first_games = games;
+            first_wins[0] = wins[0];
+            first_wins[1] = wins[1];
+        } else if (games != first_games || wins[0] != first_wins[0] || wins[1] != first_wins[1]) {
+            fprintf(stderr, "%s: the games ended differently\n", methods[i].name);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,27 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#ifndef SERVER_BOT_H
+#define SERVER_BOT_H
+
+#define BOT_LEVELS 5
+#define BOT_MAX_WORKERS 8
+#define BOT_QUEUE_MAX 1024             // searches waiting for a bot worker
+#define BOT_TABLE_MAX_MB (64 * 1024)   // largest transposition table (-t)
+
+// Full definitions in server.h
+struct Board;
+struct Game;
+
+int bot_table_init(int megabytes);
+unsigned long bot_table_entries(void);
+int bot_table_usage(void);
+int bot_best_move(const struct Board *board, int side, int level);
+void bot_turn(struct Game *game);
+int bot_pool_start(void);
+
+#endif
@@ -0,0 +1,20 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#ifndef SERVER_EPOCH_H
+#define SERVER_EPOCH_H
+
+#define EPOCH_SLOTS 64                 // reader counters, shared by hashing threads on them
+
+// Full definition in server.h
+struct EpochNode;
+
+void epoch_enter(void);
+void epoch_exit(void);
+void epoch_retire(struct EpochNode *node);
+
+#endif
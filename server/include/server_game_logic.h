@@ -8,13 +8,30 @@
 #ifndef SERVER_GAME_LOGIC_H
 #define SERVER_GAME_LOGIC_H
 
-// Full definition in server.h
+// Full definitions in server.h
 struct Game;
+struct Board;
+struct Variant;
 
+// Board variants, the classic one first
+extern const struct Variant variants[];
+extern const int variant_count;
+
+int variant_find(const char *name);
+const struct Variant *board_variant(const struct Board *board);
+
+// Bitboard engine
+void board_init(struct Board *board, int variant);
+int board_play(struct Board *board, int col, int side);
+int board_wins(const struct Board *board, int side);
+int board_wins_at(const struct Board *board, int col, int row);
+int board_full(const struct Board *board);
+char board_cell(const struct Board *board, int row, int col);
+
+// Grid API of the game handlers, on top of the engine
 void init_grid(struct Game *game);
 void format_grid(struct Game *game, char *buffer, size_t size);
 int drop_piece(struct Game *game, int col, char piece);
-int check_direction(struct Game *game, int row, int col, int dr, int dc, char piece);
 int check_winner(struct Game *game, char piece);
 int is_grid_full(struct Game *game);
 
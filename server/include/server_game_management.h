@@ -11,13 +11,19 @@
 // Full definition in server.h
 struct Game;
 
-int create_game(int creator_id);
+int create_game(int game_id, int creator_id, int variant);
+int create_bot_game(int game_id, int creator_id, int variant, int level);
 struct Game* get_game_by_id(int game_id);
+int game_snapshot(int game_id, struct Game *copy);
+void game_write_begin(struct Game *game);
+void game_write_end(struct Game *game);
 int add_join_request(int game_id, int requester_id);
+int purge_join_requests(struct Game *game);
 int process_join_request(int game_id, int requester_id, int accept);
 int make_move(int game_id, int player_id, int column);
 void cleanup_game(int game_id);
 void reset_game_for_rematch(int game_id);
+void game_turn_start(struct Game *game);
 
 #endif 
 
@@ -8,20 +8,33 @@
 #ifndef SERVER_HANDLERS_H
 #define SERVER_HANDLERS_H
 
-// Full definition in server.h
+// Full definitions in server.h
 struct Client;
+struct Game;
+struct Timer;
 
 void handle_help(struct Client *client);
 void handle_list(struct Client *client);
 void handle_status(struct Client *client);
-void handle_create(struct Client *client);
+void handle_create(struct Client *client, int variant);
+void handle_play_bot(struct Client *client, int level, int variant);
 void handle_join(struct Client *client, int game_id);
 void handle_requests(struct Client *client);
 void handle_accept_reject(struct Client *client, const char *username, int accept);
+void handle_accept_reject_id(struct Client *client, int requester_id, int accept);
 void handle_move(struct Client *client, int column);
+void handle_stats(struct Client *client);
 void handle_grid(struct Client *client);
 void handle_leave(struct Client *client);
 void handle_rematch(struct Client *client);
+void handle_bot_move(struct Game *game, int col);
+void client_welcome(struct Client *client);
+int handle_command(struct Client *client, char *buffer);
+void client_timeout(struct Timer *timer);
+void game_turn_timeout(struct Timer *timer);
+int handle_frame(struct Client *client, const unsigned char *frame, int len);
+int handle_input(struct Client *client);
+void client_disconnect(struct Client *client);
 void *handle_client(void *arg);
 void handle_signal(int sig);
 
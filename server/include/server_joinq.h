@@ -0,0 +1,20 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#ifndef SERVER_JOINQ_H
+#define SERVER_JOINQ_H
+
+// Full definition in server.h
+struct JoinQueue;
+
+int joinq_init(struct JoinQueue *q, int capacity);
+void joinq_destroy(struct JoinQueue *q);
+void joinq_clear(struct JoinQueue *q);
+int joinq_add(struct JoinQueue *q, int requester_id);
+int joinq_remove(struct JoinQueue *q, int requester_id);
+
+#endif
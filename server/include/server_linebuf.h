@@ -0,0 +1,23 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#ifndef SERVER_LINEBUF_H
+#define SERVER_LINEBUF_H
+
+#include <stddef.h>
+
+// Full definition in server.h
+struct LineBuffer;
+
+void linebuf_reset(struct LineBuffer *lb);
+char* linebuf_write_ptr(struct LineBuffer *lb, size_t *space);
+void linebuf_commit(struct LineBuffer *lb, size_t len);
+size_t linebuf_append(struct LineBuffer *lb, const char *data, size_t len);
+int linebuf_read_line(struct LineBuffer *lb, char *line, size_t size);
+int linebuf_read_frame(struct LineBuffer *lb, unsigned char *frame, size_t size);
+
+#endif
@@ -0,0 +1,19 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#ifndef SERVER_LOBBY_H
+#define SERVER_LOBBY_H
+
+// Full definitions in server.h
+struct Client;
+struct Game;
+
+int lobby_init(void);
+void lobby_update(struct Game *game);
+void lobby_send(struct Client *client);
+
+#endif
@@ -0,0 +1,55 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#ifndef SERVER_LOCK_H
+#define SERVER_LOCK_H
+
+#include <pthread.h>
+
+// Lock hierarchy: a thread holding a lock only takes locks of a higher
+// level, and never two of the same level (e.g. two client shards).
+// Game state has no lock: it belongs to the game's strand
+//
+//   LOCK_IDS         client id allocation (accept)
+//   LOCK_LOBBY       lobby directory rebuild
+//   LOCK_NAMES       username index writers, lookups that missed
+//   LOCK_CLIENT      client shard: lifetime and fields of its clients
+//   LOCK_OUTQ        one client's outbound queue
+//   LOCK_TABLE       table growth
+//   LOCK_WHEEL       timer wheel
+//   LOCK_EPOCH       retired object lists
+//   LOCK_RUN_QUEUE   strand run queue
+//   LOCK_BOT_QUEUE   bot search queue
+//
+// Built with -DLOCK_DEBUG, every LOCK() checks the order and aborts on
+// a violation
+enum {
+    LOCK_IDS = 1,
+    LOCK_LOBBY,
+    LOCK_NAMES,
+    LOCK_CLIENT,
+    LOCK_OUTQ,
+    LOCK_TABLE,
+    LOCK_WHEEL,
+    LOCK_EPOCH,
+    LOCK_RUN_QUEUE,
+    LOCK_BOT_QUEUE
+};
+
+#define LOCK_DEBUG_DEPTH 16
+
+#ifdef LOCK_DEBUG
+void lock_acquire(pthread_mutex_t *mutex, int level, const char *name);
+void lock_release(pthread_mutex_t *mutex);
+#define LOCK(mutex, level) lock_acquire((mutex), (level), #mutex)
+#define UNLOCK(mutex) lock_release(mutex)
+#else
+#define LOCK(mutex, level) pthread_mutex_lock(mutex)
+#define UNLOCK(mutex) pthread_mutex_unlock(mutex)
+#endif
+
+#endif
@@ -0,0 +1,35 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#ifndef SERVER_OUTQ_H
+#define SERVER_OUTQ_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// Full definitions in server.h
+struct Client;
+struct OutQueue;
+struct OutChunk;
+struct Response;
+
+void outq_init(struct OutQueue *q);
+void outq_consume(struct OutQueue *q, size_t bytes);
+void outq_clear(struct OutQueue *q);
+struct OutChunk* outq_detach(struct OutQueue *q);
+void outq_free_chunks(struct OutChunk *chunk);
+struct OutChunk* outq_pin(struct OutQueue *q, int max, int *count);
+void outq_unpin(struct OutQueue *q);
+int client_enqueue_response(struct Client *client, const struct Response *r);
+int client_enqueue_event(struct Client *client, const struct Response *text, int type, const void *payload, size_t len);
+int client_enqueue(struct Client *client, const char *data, size_t len);
+ssize_t client_flush(struct Client *client);
+void client_expire(struct Client *client, const char *reason);
+void client_hangup(struct Client *client);
+void client_close_socket(struct Client *client);
+
+#endif
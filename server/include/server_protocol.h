@@ -0,0 +1,134 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#ifndef SERVER_PROTOCOL_H
+#define SERVER_PROTOCOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===============================
+// BINARY PROTOCOL
+// ===============================
+//
+// A client switches to the binary protocol by sending its username as
+// "@binary <username>" at login. From then on every message, in both
+// directions, is a frame: a FrameHeader followed by header.len bytes of
+// payload. Multi-byte fields are in network byte order. Client and game
+// ids, and command arguments, take 32 bits like the ids themselves; ids
+// that do not apply are PROTO_NO_ID
+
+#define PROTO_TEXT 0
+#define PROTO_BINARY 1
+#define PROTO_BINARY_LOGIN "@binary "
+#define PROTO_NO_ID 0xFFFFFFFF
+
+typedef struct __attribute__((packed)) FrameHeader {
+    uint16_t len;               // payload bytes after the header
+    uint8_t type;
+} FrameHeader;
+
+// Server -> client frame types
+enum {
+    MSG_TEXT = 1,               // any reply without a binary form, as UTF-8 text
+    MSG_LOGIN,                  // LoginMsg
+    MSG_MOVE,                   // MoveMsg
+    MSG_BOARD,                  // BoardMsg
+    MSG_GAME_EVENT,             // GameEventMsg
+    MSG_CLIENT_EVENT            // ClientEventMsg
+};
+
+// Client -> server frame types, all carrying a CommandMsg
+enum {
+    CMD_LIST = 1,
+    CMD_STATUS,
+    CMD_CREATE,                 // arg: board variant, 0 is the classic 7x6
+    CMD_JOIN,                   // arg: game id
+    CMD_REQUESTS,
+    CMD_ACCEPT,                 // arg: requester client id
+    CMD_REJECT,                 // arg: requester client id
+    CMD_MOVE,                   // arg: column, 1 based
+    CMD_GRID,
+    CMD_LEAVE,
+    CMD_REMATCH,
+    CMD_QUIT,
+    CMD_STATS,
+    CMD_PLAY_BOT                // arg: level, board variant in the high byte
+};
+
+// MoveMsg.result
+enum { MOVE_PLAYING, MOVE_WON, MOVE_DRAW };
+
+// GameEventMsg.event
+enum {
+    GAME_EVENT_CREATED,         // player1: creator
+    GAME_EVENT_JOIN_REQUEST,    // player1: requester
+    GAME_EVENT_REJECTED,        // player1: creator
+    GAME_EVENT_STARTED,         // player1: plays X and starts, player2: plays O
+    GAME_EVENT_OVER,            // player1: winner, player2: loser
+    GAME_EVENT_DRAW,
+    GAME_EVENT_LEFT,            // player1: who left, player2: winner by forfeit
+    GAME_EVENT_REMATCH          // player1: first turn
+};
+
+// ClientEventMsg.event
+enum { CLIENT_EVENT_CONNECTED, CLIENT_EVENT_DISCONNECTED };
+
+typedef struct __attribute__((packed)) CommandMsg {
+    uint32_t arg;
+} CommandMsg;
+
+typedef struct __attribute__((packed)) LoginMsg {
+    uint32_t client_id;
+} LoginMsg;
+
+typedef struct __attribute__((packed)) MoveMsg {
+    uint32_t game_id;
+    uint32_t player_id;
+    uint8_t column;             // 1 based, as in 'move <n>'
+    uint8_t row;                // 0 is the top row
+    uint8_t piece;
+    uint8_t result;
+    uint32_t next_turn;
+} MoveMsg;
+
+typedef struct __attribute__((packed)) BoardMsg {
+    uint32_t game_id;
+    uint8_t state;
+    uint8_t rows;
+    uint8_t cols;
+    uint32_t turn;
+    uint8_t cells[GRID_MAX_ROWS * GRID_MAX_COLS];   // rows * cols of them, row-major, top row first
+} BoardMsg;
+
+typedef struct __attribute__((packed)) GameEventMsg {
+    uint8_t event;
+    uint32_t game_id;
+    uint32_t player1;
+    uint32_t player2;
+} GameEventMsg;
+
+typedef struct __attribute__((packed)) ClientEventMsg {
+    uint8_t event;
+    uint32_t client_id;
+    char username[MAX_USERNAME];
+} ClientEventMsg;
+
+// Full definitions in server.h
+struct Response;
+struct Client;
+struct Game;
+
+void proto_frame(struct Response *r, FrameHeader *hdr, uint8_t type, const void *payload, size_t len);
+void proto_frame_text(struct Response *r, FrameHeader *hdr, const struct Response *text);
+int proto_arg(const CommandMsg *cmd);
+uint32_t proto_id(int id);
+size_t proto_board(struct Game *game, BoardMsg *msg);
+void proto_game_event(GameEventMsg *msg, int event, int game_id, int player1, int player2);
+void proto_client_event(ClientEventMsg *msg, int event, struct Client *client);
+
+#endif
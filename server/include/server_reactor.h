@@ -0,0 +1,41 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#ifndef SERVER_REACTOR_H
+#define SERVER_REACTOR_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+#define REACTOR_MAX_EVENTS 256
+
+// Full definition in server.h
+struct Client;
+
+// Flush request posted to a reactor by another thread
+typedef struct ReactorMsg {
+    struct ReactorMsg *next;
+    struct Client *client;
+    int client_id;              // guards against the slot being reused
+} ReactorMsg;
+
+// One epoll loop with its own SO_REUSEPORT listener
+typedef struct Reactor {
+    int id;
+    int listen_fd;
+    int epoll_fd;
+    int wake_fd;                // eventfd, signalled when the inbox becomes non-empty
+    ReactorMsg *inbox;          // lock-free MPSC stack, newest first
+    struct Client **pending;    // flushed at the end of each batch, one entry per client
+    int pending_count;
+    pthread_t thread;
+} Reactor;
+
+int reactor_run(int listen_fd);
+void reactor_post(Reactor *reactor, struct Client *client);
+
+#endif
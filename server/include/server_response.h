@@ -0,0 +1,30 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#ifndef SERVER_RESPONSE_H
+#define SERVER_RESPONSE_H
+
+#include <stddef.h>
+
+// Full definitions in server.h
+struct Response;
+struct SharedBuffer;
+
+void response_init(struct Response *r);
+void response_static(struct Response *r, const char *text, size_t len);
+void response_copy(struct Response *r, const char *data, size_t len);
+void response_string(struct Response *r, const char *str);
+void response_shared(struct Response *r, struct SharedBuffer *buf);
+
+struct SharedBuffer *shared_buffer_create(const char *data, size_t len);
+void shared_buffer_ref(struct SharedBuffer *buf);
+void shared_buffer_release(struct SharedBuffer *buf);
+
+// Append a string literal without copying it
+#define RESPONSE_LITERAL(r, lit) response_static((r), (lit), sizeof(lit) - 1)
+
+#endif
@@ -0,0 +1,20 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#ifndef SERVER_SLOTS_H
+#define SERVER_SLOTS_H
+
+#define SLOT_WORD_BITS 64
+
+// Full definition in server.h
+struct SlotMap;
+
+int slots_init(struct SlotMap *map, int count);
+int slot_alloc(struct SlotMap *map);
+void slot_free(struct SlotMap *map, int slot);
+
+#endif
@@ -0,0 +1,22 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#ifndef SERVER_STRAND_H
+#define SERVER_STRAND_H
+
+#define STRAND_MAX_WORKERS 64
+
+// Full definitions in server.h
+struct Strand;
+struct StrandTask;
+
+void strand_init(struct Strand *strand);
+void strand_post(struct Strand *strand, struct StrandTask *task);
+struct Strand *strand_current(void);
+int strand_pool_start(void);
+
+#endif
@@ -0,0 +1,30 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#ifndef SERVER_TABLE_H
+#define SERVER_TABLE_H
+
+#include <stddef.h>
+
+#define TABLE_SEGMENT_BITS 10
+#define TABLE_SEGMENT_SIZE (1 << TABLE_SEGMENT_BITS)
+#define TABLE_SEGMENT_MASK (TABLE_SEGMENT_SIZE - 1)
+
+// Element of a table by slot, the slot must be below the capacity
+#define TABLE_AT(table, type, slot) \
+    (&((type *)(table)->segments[(slot) >> TABLE_SEGMENT_BITS])[(slot) & TABLE_SEGMENT_MASK])
+
+// Full definition in server.h
+struct Table;
+
+int table_init(struct Table *table, size_t elem_size, int limit,
+               int (*init)(void *elem, int slot), void (*destroy)(void *elem));
+int table_alloc(struct Table *table);
+void table_free(struct Table *table, int slot);
+int table_capacity(const struct Table *table);
+
+#endif
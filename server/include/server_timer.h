@@ -0,0 +1,27 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#ifndef SERVER_TIMER_H
+#define SERVER_TIMER_H
+
+#define TIMER_TICK_MS 100
+#define TIMER_LEVELS 4
+#define TIMER_SLOT_BITS 6
+#define TIMER_SLOTS (1 << TIMER_SLOT_BITS)
+
+// Full definition in server.h
+struct Timer;
+
+void timer_init(struct Timer *timer, void (*expired)(struct Timer *timer));
+void timer_arm(struct Timer *timer, unsigned long ticks, int tag);
+void timer_cancel(struct Timer *timer);
+unsigned long timer_now(void);
+int timer_start(void);
+
+#define TIMER_TICKS(ms) (((ms) + TIMER_TICK_MS - 1) / TIMER_TICK_MS)
+
+#endif
@@ -0,0 +1,36 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#ifndef SERVER_TRANSPORT_H
+#define SERVER_TRANSPORT_H
+
+#include <stddef.h>
+
+// Full definitions in server.h
+struct Client;
+struct Response;
+
+// Network backend: owns the accept/recv loop and drains the outbound queues
+typedef struct Transport {
+    const char *name;
+    int (*run)(int listen_fd);                  // -1 if unavailable
+    void (*kick)(struct Client *client);        // outbound queue became non-empty
+    const struct Transport *fallback;           // used when run fails
+} Transport;
+
+extern const Transport threads_transport;
+extern const Transport epoll_transport;
+extern const Transport uring_transport;
+extern const Transport *transport;
+
+const Transport* transport_by_name(const char *name);
+void client_send(struct Client *client, const char *data, size_t len);
+void client_send_response(struct Client *client, const struct Response *r);
+void client_send_event(struct Client *client, const struct Response *text, int type, const void *payload, size_t len);
+void client_kick(struct Client *client);
+
+#endif
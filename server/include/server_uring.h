@@ -0,0 +1,18 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#ifndef SERVER_URING_H
+#define SERVER_URING_H
+
+#define URING_ENTRIES 1024
+#define URING_BUF_COUNT 256         // provided recv buffers, power of two
+#define URING_BUF_GROUP 0
+#define URING_SEND_CHAIN 16         // max linked sends per client per submission
+
+int uring_run(int listen_fd);
+
+#endif
@@ -10,11 +10,25 @@
 
 // Full definition in server.h
 struct Client;
+struct Response;
+struct sockaddr_in;
 
 void send_to_client(int client_id, const char *message);
+void send_response_to_client(int client_id, const struct Response *r);
+void send_event_to_client(int client_id, const struct Response *text, int type, const void *payload, size_t len);
 void broadcast_except(int exclude_id, const char *message);
+void broadcast_event_except(int exclude_id, const char *message, int type, const void *payload, size_t len);
 void broadcast_all(const char *message);
+int client_indexes_init(int max_clients);
+int open_listener(int port);
+struct Client* accept_client(int client_socket, struct sockaddr_in *client_addr, int reactor_id);
+void release_client(struct Client *client);
 struct Client* get_client_by_id(int client_id);
+struct Client* lock_client_by_id(int client_id);
+void unlock_client(struct Client *client);
+int client_register_name(struct Client *client, const char *name);
+void client_unregister_name(struct Client *client);
+struct Client* get_client_by_username(const char *name);
 const char* get_username(int client_id);
 
 #endif
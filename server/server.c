@@ -6,126 +6,152 @@
  */
 
 #include "server.h"
+#include <sys/resource.h>
 
 int server_socket = -1;
-Client clients[MAX_CLIENTS];
+Table client_table;
 int client_count = 0;
-pthread_mutex_t clients_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-Game games[MAX_GAMES];
-pthread_mutex_t games_mutex = PTHREAD_MUTEX_INITIALIZER;
+Table game_table;
 
 volatile int server_running = 1;
+ServerConfig config = { .port = PORT, .reactors = 1, .max_clients = MAX_CLIENTS, .max_games = MAX_GAMES,
+                        .max_join_requests = MAX_JOIN_REQUESTS, .bot_table_mb = BOT_TABLE_MB };
+OutqStats outq_stats;
+BotTableStats bot_table_stats;
 
 
+// =========================
+// STARTUP
+// ==========================
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-m threads|epoll|uring] [-r reactors] [-c max_clients] [-g max_games] [-j max_join_requests] [-t bot_table_mb] [port]\n", prog);
+    exit(EXIT_FAILURE);
+}
+
+static int client_slot_init(void *elem, int slot) {
+    Client *client = elem;
+    client->slot = slot;
+    client->is_connected = 0;
+    client->socket = -1;
+    client->current_game_id = -1;
+    client->opening_game_id = -1;
+    outq_init(&client->out);
+    timer_init(&client->timer, client_timeout);
+    return 0;
+}
+
+static int game_slot_init(void *elem, int slot) {
+    Game *game = elem;
+    game->id = slot;
+    game->is_active = 0;
+    timer_init(&game->turn_timer, game_turn_timeout);
+    strand_init(&game->strand);
+    return joinq_init(&game->join_requests, config.max_join_requests);
+}
+
+static void game_slot_destroy(void *elem) {
+    Game *game = elem;
+    joinq_destroy(&game->join_requests);
+}
+
+/**
+ * Allow as many open files as the hard limit does, every client
+ * holds one
+ */
+static void raise_fd_limit(void) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < (rlim_t)config.max_clients + 64) {
+        printf("[SERVER] Warning: only %lu open files allowed\n", (unsigned long)limit.rlim_cur);
+    }
+}
+
 // =========================
 // GAME
 // ==========================
 
 int main(int argc, char *argv[]) {
-    struct sockaddr_in server_addr, client_addr;
-    socklen_t client_len = sizeof(client_addr);
-    int port = PORT;
+    int opt;
     
-    if (argc > 1) {
-        port = atoi(argv[1]);
+    while ((opt = getopt(argc, argv, "m:r:c:g:j:t:")) != -1) {
+        switch (opt) {
+            case 'm':
+                transport = transport_by_name(optarg);
+                if (!transport) usage(argv[0]);
+                break;
+            case 'r':
+                config.reactors = atoi(optarg);
+                if (config.reactors < 1 || config.reactors > MAX_REACTORS) usage(argv[0]);
+                break;
+            case 'c':
+                config.max_clients = atoi(optarg);
+                if (config.max_clients < 1) usage(argv[0]);
+                break;
+            case 'g':
+                config.max_games = atoi(optarg);
+                if (config.max_games < 1) usage(argv[0]);
+                break;
+            case 'j':
+                config.max_join_requests = atoi(optarg);
+                if (config.max_join_requests < 1) usage(argv[0]);
+                break;
+            case 't':
+                config.bot_table_mb = atoi(optarg);
+                if (config.bot_table_mb < 0 || config.bot_table_mb > BOT_TABLE_MAX_MB) usage(argv[0]);
+                break;
+            default:
+                usage(argv[0]);
+        }
     }
     
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        clients[i].is_connected = 0;
-        clients[i].socket = -1;
-        clients[i].current_game_id = -1;
+    if (optind < argc) {
+        config.port = atoi(argv[optind]);
     }
     
-    for (int i = 0; i < MAX_GAMES; i++) {
-        games[i].is_active = 0;
+    if (table_init(&client_table, sizeof(Client), config.max_clients, client_slot_init, NULL) < 0 ||
+        table_init(&game_table, sizeof(Game), config.max_games, game_slot_init, game_slot_destroy) < 0 ||
+        client_indexes_init(config.max_clients) < 0 || lobby_init() < 0 ||
+        bot_table_init(config.bot_table_mb) < 0) {
+        perror("[SERVER] Table allocation error");
+        exit(EXIT_FAILURE);
     }
+    raise_fd_limit();
     
     signal(SIGINT, handle_signal);
     signal(SIGTERM, handle_signal);
-    server_socket = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_socket < 0) {
-        perror("[SERVER] Socket creation error");
-        exit(EXIT_FAILURE);
-    }
-    
-    int opt = 1;
-    if (setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-        perror("[SERVER] setsockopt error");
-        exit(EXIT_FAILURE);
-    }
-    
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = INADDR_ANY;
-    server_addr.sin_port = htons(port);
-    
-    if (bind(server_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
-        perror("[SERVER] Binding error");
-        close(server_socket);
+    server_socket = open_listener(config.port);
+    if (server_socket < 0 || timer_start() < 0) {
         exit(EXIT_FAILURE);
     }
-    
-    if (listen(server_socket, MAX_CLIENTS) < 0) {
-        perror("[SERVER] Listen error");
-        close(server_socket);
+    config.workers = strand_pool_start();
+    config.bot_workers = bot_pool_start();
+    if (config.workers < 0 || config.bot_workers < 0) {
         exit(EXIT_FAILURE);
     }
     
     printf("╔═══════════════════════════════════════════════════════════════╗\n");
     printf("║           CONNECT 4 - MULTIPLAYER SERVER                      ║\n");
     printf("╠═══════════════════════════════════════════════════════════════╣\n");
-    printf("║  Port: %-5d                                                   ║\n", port);
+    printf("║  Port: %-5d                                                   ║\n", config.port);
+    printf("║  I/O model: %-8s                                          ║\n", transport->name);
+    if (transport == &epoll_transport) {
+        printf("║  Reactors: %-3d                                                ║\n", config.reactors);
+    }
+    printf("║  Game workers: %-3d  Bot workers: %-3d                          ║\n", config.workers, config.bot_workers);
+    printf("║  Bot table: %-5d MiB, %-9lu entries                      ║\n", config.bot_table_mb, bot_table_entries());
+    printf("║  Max clients: %-7d  Max games: %-7d                     ║\n", config.max_clients, config.max_games);
     printf("║  Waiting for connections...                                   ║\n");
     printf("╚═══════════════════════════════════════════════════════════════╝\n");
     
-    while (server_running) {
-        int client_socket = accept(server_socket, 
-                                   (struct sockaddr *)&client_addr, 
-                                   &client_len);
-        
-        if (client_socket < 0) {
-            if (server_running) {
-                perror("[SERVER] Accept error");
-            }
-            continue;
-        }
-        
-        pthread_mutex_lock(&clients_mutex);
-        int slot = -1;
-        for (int i = 0; i < MAX_CLIENTS; i++) {
-            if (!clients[i].is_connected) {
-                slot = i;
-                break;
-            }
-        }
-        
-        if (slot < 0) {
-            pthread_mutex_unlock(&clients_mutex);
-            char *full_msg = "Server full. Try again later.\n";
-            send(client_socket, full_msg, strlen(full_msg), 0);
-            close(client_socket);
-            continue;
-        }
-        
-        client_count++;
-        clients[slot].id = client_count;
-        clients[slot].socket = client_socket;
-        clients[slot].is_connected = 1;
-        clients[slot].current_game_id = -1;
-        clients[slot].address = client_addr;
-        strcpy(clients[slot].username, "");
-        pthread_mutex_unlock(&clients_mutex);
-
-        if (pthread_create(&clients[slot].thread, NULL, handle_client, &clients[slot]) != 0) {
-            perror("[SERVER] Thread creation error");
-            pthread_mutex_lock(&clients_mutex);
-            clients[slot].is_connected = 0;
-            close(client_socket);
-            pthread_mutex_unlock(&clients_mutex);
-            continue;
-        }
-        pthread_detach(clients[slot].thread);
+    while (transport->run(server_socket) < 0 && transport->fallback) {
+        printf("[SERVER] %s transport unavailable, falling back to %s\n",
+               transport->name, transport->fallback->name);
+        transport = transport->fallback;
     }
     close(server_socket);
     return 0;
@@ -17,6 +17,9 @@
 #include <signal.h>
 #include <errno.h>
 #include <time.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/uio.h>
 
 // =======================
 // CONSTANTS
@@ -24,19 +27,43 @@
 
 #define PORT 8080
 #define BUFFER_SIZE 4096
-#define MAX_CLIENTS 100
-#define MAX_GAMES 50
+#define MAX_CLIENTS 100000             // default client limit (-c)
+#define MAX_GAMES 50000                // default game limit (-g)
+#define MAX_JOIN_REQUESTS 16           // default pending join requests per game (-j)
+#define BOT_TABLE_MB 64                // default bot transposition table size, MiB (-t)
 #define MAX_USERNAME 32
+#define MAX_REACTORS 64
+#define CACHE_LINE 64
+#define CLIENT_LOCK_SHARDS 64          // client locks, by slot
+#define CLIENT_JOIN_TRACK 8            // latest join requests withdrawn at disconnect
+#define OUTQ_MAX_BYTES (256 * 1024)    // per-client outbound queue bound
+#define OUTQ_HIGH_WATER (64 * 1024)    // above: shed notices and stale boards
+#define OUTQ_LOW_WATER (16 * 1024)     // below: deliver everything again
+#define OUTQ_MAX_IOV 64
+#define LINEBUF_SIZE 1024              // per-client input ring, power of two
+#define RESPONSE_MAX_SEGMENTS 16
+#define LIST_LINE_MAX 128              // longest line of the game list
+#define LOGIN_TIMEOUT_MS (30 * 1000)           // to send a username
+#define IDLE_TIMEOUT_MS (10 * 60 * 1000)       // without commands, outside a game
+#define TURN_TIMEOUT_MS (2 * 60 * 1000)        // to make a move, or the game is abandoned
 
-// Grid dimensions
-#define GRID_ROWS 6
-#define GRID_COLS 7
+// Largest grid of the board variants (see server_game_logic.c)
+#define GRID_MAX_ROWS 7
+#define GRID_MAX_COLS 9
+
+// Bitboard layout: bit col * (rows + 1) + row, row 0 at the bottom.
+// The spare bit on top of every column stays clear, so that shifts never
+// carry a line of pieces from one column into the next
 
 // Player symbols
 #define EMPTY '.'
 #define PLAYER1 'X'
 #define PLAYER2 'O'
 
+// Player id of the server-side engine in the opponent seat of a game
+#define BOT_ID (-2)
+#define BOT_NAME "Bot"
+
 // Game states
 typedef enum {
     GAME_CREATED,       
@@ -53,57 +80,300 @@ typedef enum {
 struct Game;
 struct Client;
 
+// How a queued message may be shed when its client falls behind
+typedef enum {
+    OUT_ESSENTIAL,              // always delivered (or the client is evicted)
+    OUT_NOTICE,                 // lobby broadcast, dropped under pressure
+    OUT_BOARD                   // board update, superseded by the next one
+} OutKind;
+
+// Immutable message rendered once and queued on many clients
+typedef struct SharedBuffer {
+    int refs;                   // one per queued chunk, plus the creator's
+    size_t len;
+    char data[];
+} SharedBuffer;
+
+// Message waiting to be written to a socket: a list of segments sent
+// with a single sendmsg. Copied segments live in the same allocation,
+// right after the iovec array
+typedef struct OutChunk {
+    struct OutChunk *next;
+    SharedBuffer *shared;       // referenced by a segment, released with the chunk
+    OutKind kind;
+    size_t len;                 // bytes not yet written
+    int iov_first;              // first segment not completely written
+    int iov_count;
+    struct iovec iov[];
+} OutChunk;
+
+// Response under construction: static segments (string literals) and
+// shared buffers are referenced, the others are copied once into the
+// queued chunk
+typedef struct Response {
+    struct iovec seg[RESPONSE_MAX_SEGMENTS];
+    unsigned char copy[RESPONSE_MAX_SEGMENTS];
+    SharedBuffer *shared;
+    OutKind kind;
+    int count;
+    size_t len;
+    size_t copy_len;
+} Response;
+
+// Bounded per-client outbound queue
+typedef struct OutQueue {
+    pthread_mutex_t lock;
+    OutChunk *head;
+    OutChunk *tail;
+    size_t bytes;
+    int pinned;                 // chunks at the head being written asynchronously
+    int congested;              // above the high watermark, not yet back below the low one
+} OutQueue;
+
+// Timer of the timer wheel, embedded in the object it belongs to
+typedef struct Timer {
+    struct Timer *next;
+    struct Timer **pprev;       // NULL when not armed
+    struct Timer *fire_next;    // list of timers expired in the same batch
+    unsigned long expires;      // in ticks
+    int tag;                    // identifies the owner it was armed for
+    void (*expired)(struct Timer *timer);
+} Timer;
+
+// Unit of work posted to a strand, embedded in the object it carries
+typedef struct StrandTask {
+    struct StrandTask *next;
+    void (*run)(struct StrandTask *task);
+} StrandTask;
+
+// Object unpublished from a structure read under epoch_enter(), released
+// once no reader can still hold it; embedded in the object
+typedef struct EpochNode {
+    struct EpochNode *next;
+    void (*release)(struct EpochNode *node);
+} EpochNode;
+
+// Serial executor: its tasks run one at a time, in posting order, on
+// whichever worker of the pool picks it up
+typedef struct Strand {
+    StrandTask *inbox;          // lock-free MPSC stack, newest first
+    int scheduled;              // on the run queue or on a worker
+    struct Strand *next_ready;  // run queue link
+} Strand;
+
+// Free slots of a table, one bit each
+typedef struct SlotMap {
+    uint64_t *words;            // bit set: slot free
+    uint64_t *summary;          // bit set: word may have a free slot
+    int nwords;
+    int nsummary;
+} SlotMap;
+
+// Growable array of fixed size elements, in segments that never move
+typedef struct Table {
+    char **segments;            // one per TABLE_SEGMENT_SIZE slots, NULL until needed
+    size_t elem_size;
+    int capacity;               // slots backed by a segment
+    int limit;
+    SlotMap free;
+    int (*init)(void *elem, int slot);
+    void (*destroy)(void *elem);    // undoes init, NULL: nothing to undo
+    pthread_mutex_t grow_lock;
+} Table;
+
+// Slow consumer policy counters
+typedef struct OutqStats {
+    unsigned long congested;        // times a queue crossed the high watermark
+    unsigned long notices_dropped;
+    unsigned long boards_coalesced;
+    unsigned long evictions;
+} OutqStats;
+
+// Bot transposition table counters, added up at the end of every search
+typedef struct BotTableStats {
+    unsigned long probes;
+    unsigned long hits;             // the position was in the table
+    unsigned long cutoffs;          // ... deep enough to skip searching it
+} BotTableStats;
+
+// Per-client input ring, framed on '\n'
+typedef struct LineBuffer {
+    char data[LINEBUF_SIZE];
+    unsigned head;              // start of the first unread line
+    unsigned tail;              // end of the received data
+    unsigned scan;              // no '\n' between head and scan
+    int discard;                // dropping the rest of an overlong line
+} LineBuffer;
+
 // Client structure
+// Grouped by who writes what, each group on its own cache lines, so that
+// the threads working on neighbouring clients do not share lines
 typedef struct Client {
+    // Read on every lookup, written at accept and login only
     int id;
+    int slot;                   // position in the client table, fixed
     int socket;
-    char username[MAX_USERNAME];
     int is_connected;
-    int current_game_id;        
+    int reactor_id;             // owning reactor, -1 outside the epoll model
+    int proto;                  // PROTO_TEXT or PROTO_BINARY, chosen at login
+    struct Client *name_next;   // username index chain
+    char username[MAX_USERNAME];
+    
+    // Written by whoever runs the client's commands
+    int current_game_id __attribute__((aligned(CACHE_LINE)));
+    int pending;                // commands queued or running
+    int hangup;                 // quit from a worker: run nothing more
+    int flush_scheduled;        // id + 1 of the reactor that queued it for a flush
+    unsigned long last_active;  // tick of the last command
+    StrandTask *tasks;          // commands queued behind the running one, newest first
+    StrandTask *backlog;        // the same, oldest first, owned by whoever runs them
+    Timer timer;                // login, then idle timeout
+    int join_games[CLIENT_JOIN_TRACK];  // games it sent the latest join requests to
+    int join_count;             // join requests sent, join_games is indexed modulo
+    int opening_game_id;        // slot taken for the create command running, -1: none
+    
+    // Written by every thread sending to the client
+    OutQueue out __attribute__((aligned(CACHE_LINE)));
+    
+    // Written by the owner of the socket
+    LineBuffer in __attribute__((aligned(CACHE_LINE)));
+    
+    // Cold
     struct sockaddr_in address;
     pthread_t thread;
-} Client;
+} __attribute__((aligned(CACHE_LINE))) Client;
 
-// Join request structure
+// Startup configuration
+typedef struct ServerConfig {
+    int port;
+    int reactors;               // epoll reactor threads
+    int workers;                // game strand worker threads
+    int max_clients;
+    int max_games;
+    int max_join_requests;      // pending per game
+    int bot_workers;            // bot search threads
+    int bot_table_mb;           // transposition table size, 0: none
+} ServerConfig;
+
+// Pending join request, an entry of its game's pool
 typedef struct JoinRequest {
     int requester_id;
-    int processed;              
-    struct JoinRequest *next;
+    int prev;                   // queue links, entry indexes, -1: none
+    int next;                   // also links the free entries
 } JoinRequest;
 
+// Bounded FIFO of the pending join requests of a game, indexed by requester
+typedef struct JoinQueue {
+    JoinRequest *entries;       // pool of config.max_join_requests entries
+    int *index;                 // requester hash -> entry + 1, linear probing
+    int index_mask;
+    int head;                   // oldest, -1 when empty
+    int tail;
+    int free;                   // first unused entry
+    int count;
+} JoinQueue;
+
+typedef unsigned __int128 Bitboard;
+
+// Game board: the pieces of each player (PLAYER1, PLAYER2) as bitboards,
+// how many pieces every column holds and how many were played
+typedef struct Board {
+    Bitboard pieces[2];
+    uint8_t heights[GRID_MAX_COLS];
+    uint8_t moves;
+    uint8_t variant;            // index in variants[]
+} Board;
+
+// Board variant: its geometry, and the engine compiled for it
+typedef struct Variant {
+    const char *name;           // as in 'create <name>'
+    int cols;
+    int rows;
+    int connect;                // pieces in a row that win
+    int (*play)(Board *board, int col, int side);
+    int (*wins)(const Board *board, int side);
+    int (*wins_at)(const Board *board, int col, int row);
+} Variant;
+
 // Game structure
+// The board and the fields a move checks before playing (state, turn,
+// is_active, creator) fill the first cache line exactly; id, seq and the
+// other players, read or written once the move is played, start the
+// second. The strand, written by every thread posting to it, has its own.
+// Board, state, turn, players and winner are written by the game's strand
+// only, under seq, so that other threads can copy them without locking
 typedef struct Game {
-    int id;
-    char grid[GRID_ROWS][GRID_COLS];
+    Board board;
     GameState state;
+    int current_turn;           
+    int is_active;              
     int creator_id;             
+    
+    int id;
+    unsigned seq;               // odd while the fields above are being changed
     int opponent_id;            
-    int current_turn;           
     int winner_id;              
-    int is_active;              
-    JoinRequest *join_requests; 
-    pthread_mutex_t game_mutex; 
-} Game;
+    unsigned long turn_started; // tick of the last move
+    Timer turn_timer;           // abandoned game timeout
+    JoinQueue join_requests;    // pending ones only
+    int bot_level;              // opponent_id is BOT_ID, 0 otherwise
+    unsigned bot_tag;           // search whose move the game waits for
+    int listed;                 // in the lobby directory, as below (lobby lock)
+    GameState listed_state;
+    int listed_creator;
+    
+    Strand strand __attribute__((aligned(CACHE_LINE)));   // runs every operation on the game
+} __attribute__((aligned(CACHE_LINE))) Game;
+
+_Static_assert(offsetof(Game, creator_id) + sizeof(int) <= CACHE_LINE,
+               "the board and the fields a move checks must fit the first cache line");
+_Static_assert(offsetof(Game, winner_id) + sizeof(int) <= 2 * CACHE_LINE,
+               "seq and the players must fit the second cache line");
 
 // ==========================
 // HEADER INCLUDES
 // ==========================
 
+#include "include/server_lock.h"
 #include "include/server_utils.h"
 #include "include/server_game_logic.h"
 #include "include/server_game_management.h"
 #include "include/server_handlers.h"
+#include "include/server_response.h"
+#include "include/server_protocol.h"
+#include "include/server_outq.h"
+#include "include/server_linebuf.h"
+#include "include/server_transport.h"
+#include "include/server_reactor.h"
+#include "include/server_uring.h"
+#include "include/server_timer.h"
+#include "include/server_strand.h"
+#include "include/server_slots.h"
+#include "include/server_table.h"
+#include "include/server_epoch.h"
+#include "include/server_lobby.h"
+#include "include/server_joinq.h"
+#include "include/server_bot.h"
 
 // ===========================
 // GLOBAL VARIABLES
 // ===========================
 
 extern int server_socket;
-extern Client clients[MAX_CLIENTS];
+extern Table client_table;
 extern int client_count;
-extern pthread_mutex_t clients_mutex;
-extern Game games[MAX_GAMES];
-extern pthread_mutex_t games_mutex;
+extern Table game_table;
 extern volatile int server_running;
+extern ServerConfig config;
+extern OutqStats outq_stats;
+extern BotTableStats bot_table_stats;
+
+static inline Client *client_at(int slot) {
+    return TABLE_AT(&client_table, Client, slot);
+}
+
+static inline Game *game_at(int game_id) {
+    return TABLE_AT(&game_table, Game, game_id);
+}
 
 #endif
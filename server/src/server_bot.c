@@ -0,0 +1,529 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#include "../server.h"
+#include <limits.h>
+
+// ===============================
+// TRANSPOSITION TABLE
+// ===============================
+//
+// Shared by every bot worker and kept from one search to the next, so
+// that games going through the same openings reuse each other's work.
+// A position is keyed by the smaller Zobrist hash of the board and of its
+// mirror image, which play alike; the stored move is mirrored back.
+// Entries are written without locking, as the key xor the data next to
+// the data: a torn write no longer matches its key and reads as a miss.
+// A bucket fills one cache line; a new entry replaces the same position
+// unless that one was searched deeper, else the shallowest entry, those
+// of earlier searches counting as shallower the older they are
+
+#define BOT_BUCKET_ENTRIES 4
+#define BOT_CELLS (GRID_MAX_COLS * (GRID_MAX_ROWS + 1))
+#define BOT_USAGE_SAMPLE 1000          // buckets counted by bot_table_usage()
+
+enum { BOUND_EXACT = 1, BOUND_LOWER, BOUND_UPPER };
+
+typedef struct BotEntry {
+    uint64_t check;                    // key ^ data
+    uint64_t data;                     // 0: empty
+} BotEntry;
+
+typedef struct BotBucket {
+    BotEntry entries[BOT_BUCKET_ENTRIES];
+} __attribute__((aligned(CACHE_LINE))) BotBucket;
+
+// Zobrist hashes of a board and of its mirror image
+typedef struct BotKey {
+    uint64_t hash;
+    uint64_t mirror;
+} BotKey;
+
+static BotBucket *bot_table;           // NULL: no table
+static uint64_t bot_table_mask;        // buckets - 1
+static uint64_t bot_zobrist[2][BOT_CELLS];
+static uint64_t bot_zobrist_turn;      // player 1 to move
+static unsigned bot_generation;        // searches started
+
+// Entry data: score in bits 0-15, depth 16-23, bound 24-25, move 26-29,
+// generation (of the search that stored it) 32-39
+#define ENTRY_PACK(score, depth, bound, move, gen) \
+    ((uint64_t)(uint16_t)(score) | (uint64_t)(depth) << 16 | (uint64_t)(bound) << 24 | \
+     (uint64_t)(move) << 26 | (uint64_t)((gen) & 0xFF) << 32)
+#define ENTRY_SCORE(data) ((int)(int16_t)((data) & 0xFFFF))
+#define ENTRY_DEPTH(data) ((int)((data) >> 16 & 0xFF))
+#define ENTRY_BOUND(data) ((int)((data) >> 24 & 0x3))
+#define ENTRY_MOVE(data) ((int)((data) >> 26 & 0xF))
+#define ENTRY_GEN(data) ((unsigned)((data) >> 32 & 0xFF))
+
+static uint64_t bot_mix(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/**
+ * Draw the Zobrist keys and allocate the largest power of two of buckets
+ * within the budget (0: no table)
+ */
+int bot_table_init(int megabytes) {
+    uint64_t seed = 0;
+    for (int side = 0; side < 2; side++) {
+        for (int i = 0; i < BOT_CELLS; i++) {
+            bot_zobrist[side][i] = bot_mix(&seed);
+        }
+    }
+    bot_zobrist_turn = bot_mix(&seed);
+    if (megabytes == 0) return 0;
+    
+    size_t budget = (size_t)megabytes << 20;
+    size_t buckets = 1;
+    while (2 * buckets * sizeof(BotBucket) <= budget) buckets <<= 1;
+    if (posix_memalign((void **)&bot_table, CACHE_LINE, buckets * sizeof(BotBucket)) != 0) {
+        bot_table = NULL;
+        return -1;
+    }
+    memset(bot_table, 0, buckets * sizeof(BotBucket));
+    bot_table_mask = buckets - 1;
+    return 0;
+}
+
+unsigned long bot_table_entries(void) {
+    return bot_table ? (bot_table_mask + 1) * BOT_BUCKET_ENTRIES : 0;
+}
+
+/**
+ * Entries in use, per mille, counted on the first buckets
+ */
+int bot_table_usage(void) {
+    if (!bot_table) return 0;
+    uint64_t sample = bot_table_mask < BOT_USAGE_SAMPLE ? bot_table_mask + 1 : BOT_USAGE_SAMPLE;
+    uint64_t used = 0;
+    for (uint64_t b = 0; b < sample; b++) {
+        for (int i = 0; i < BOT_BUCKET_ENTRIES; i++) {
+            used += __atomic_load_n(&bot_table[b].entries[i].data, __ATOMIC_RELAXED) != 0;
+        }
+    }
+    return (int)(used * 1000 / (sample * BOT_BUCKET_ENTRIES));
+}
+
+/**
+ * Data of the entry of a position, 0 if the table does not hold it
+ */
+static uint64_t bot_table_probe(uint64_t key) {
+    BotEntry *entries = bot_table[key & bot_table_mask].entries;
+    for (int i = 0; i < BOT_BUCKET_ENTRIES; i++) {
+        uint64_t data = __atomic_load_n(&entries[i].data, __ATOMIC_RELAXED);
+        uint64_t check = __atomic_load_n(&entries[i].check, __ATOMIC_RELAXED);
+        if (data && (check ^ data) == key) return data;
+    }
+    return 0;
+}
+
+static void bot_table_store(uint64_t key, uint64_t data) {
+    BotEntry *entries = bot_table[key & bot_table_mask].entries;
+    BotEntry *victim = NULL;
+    int victim_depth = INT_MAX;
+    for (int i = 0; i < BOT_BUCKET_ENTRIES; i++) {
+        uint64_t old = __atomic_load_n(&entries[i].data, __ATOMIC_RELAXED);
+        uint64_t check = __atomic_load_n(&entries[i].check, __ATOMIC_RELAXED);
+        // Entries are never emptied: the following ones are empty too
+        if (!old) {
+            victim = &entries[i];
+            break;
+        }
+        if ((check ^ old) == key) {
+            if (ENTRY_DEPTH(old) > ENTRY_DEPTH(data)) return;
+            victim = &entries[i];
+            break;
+        }
+        int depth = ENTRY_DEPTH(old) - (int)((ENTRY_GEN(data) - ENTRY_GEN(old)) & 0xFF);
+        if (depth < victim_depth) {
+            victim_depth = depth;
+            victim = &entries[i];
+        }
+    }
+    __atomic_store_n(&victim->check, key ^ data, __ATOMIC_RELAXED);
+    __atomic_store_n(&victim->data, data, __ATOMIC_RELAXED);
+}
+
+// ===============================
+// BOT SEARCH
+// ===============================
+//
+// Negamax with alpha-beta pruning on the game's bitboards, deepened one
+// ply at a time until the level's depth or time budget runs out; the
+// move of the last complete iteration is played. Columns are tried from
+// the center out, the best move the table knows of first
+
+#define BOT_WIN 10000                  // a win now; later ones score less
+#define BOT_CLOCK_NODES 1024           // nodes between two deadline checks
+
+static const struct {
+    int depth;
+    int budget_ms;
+} bot_levels[BOT_LEVELS] = {
+    { 1, 20 },
+    { 3, 100 },
+    { 5, 250 },
+    { 9, 500 },
+    { GRID_MAX_ROWS * GRID_MAX_COLS, 1000 },
+};
+
+typedef struct BotSearch {
+    const Variant *variant;
+    int order[GRID_MAX_COLS];          // columns, center first
+    struct timespec deadline;
+    unsigned long nodes;
+    int stopped;
+    unsigned generation;
+    BotTableStats stats;               // added to bot_table_stats at the end
+} BotSearch;
+
+static int bot_out_of_time(BotSearch *s) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec > s->deadline.tv_sec ||
+           (now.tv_sec == s->deadline.tv_sec && now.tv_nsec >= s->deadline.tv_nsec);
+}
+
+static int bot_count(Bitboard pieces) {
+    return __builtin_popcountll((uint64_t)pieces) + __builtin_popcountll((uint64_t)(pieces >> 64));
+}
+
+/**
+ * Keys of a board with a player (0 or 1) to move
+ */
+static BotKey bot_key(const Board *board, int side) {
+    const Variant *v = board_variant(board);
+    int stride = v->rows + 1;
+    uint64_t seed = ~(uint64_t)board->variant;
+    BotKey key;
+    key.hash = key.mirror = bot_mix(&seed) ^ (side ? bot_zobrist_turn : 0);
+    
+    for (int c = 0; c < v->cols; c++) {
+        for (int r = 0; r < board->heights[c]; r++) {
+            int owner = (int)(board->pieces[1] >> (c * stride + r) & 1);
+            key.hash ^= bot_zobrist[owner][c * stride + r];
+            key.mirror ^= bot_zobrist[owner][(v->cols - 1 - c) * stride + r];
+        }
+    }
+    return key;
+}
+
+/**
+ * Keys after a player dropped a piece at col, row
+ */
+static BotKey bot_key_play(const BotSearch *s, BotKey key, int col, int row, int side) {
+    int stride = s->variant->rows + 1;
+    key.hash ^= bot_zobrist[side][col * stride + row] ^ bot_zobrist_turn;
+    key.mirror ^= bot_zobrist[side][(s->variant->cols - 1 - col) * stride + row] ^ bot_zobrist_turn;
+    return key;
+}
+
+/**
+ * Score of a position without a winner for the player to move: pieces
+ * near the center take part in more lines
+ */
+static int bot_evaluate(const BotSearch *s, const Board *board, int side) {
+    const Variant *v = s->variant;
+    Bitboard column = ((Bitboard)1 << v->rows) - 1;
+    int score = 0;
+    
+    for (int c = 0; c < v->cols; c++) {
+        int weight = v->cols / 2 - abs(2 * c - (v->cols - 1)) / 2;
+        Bitboard cells = column << (c * (v->rows + 1));
+        score += weight * (bot_count(board->pieces[side] & cells) - bot_count(board->pieces[1 - side] & cells));
+    }
+    return score;
+}
+
+/**
+ * Best score the player to move can reach within depth plies, as far
+ * as the window alpha, beta needs to know
+ */
+static int bot_negamax(BotSearch *s, const Board *board, BotKey key, int side, int depth, int alpha, int beta) {
+    if (++s->nodes % BOT_CLOCK_NODES == 0 && bot_out_of_time(s)) s->stopped = 1;
+    if (s->stopped) return 0;
+    
+    int cols = s->variant->cols;
+    int mirrored = key.mirror < key.hash;
+    uint64_t canonical = mirrored ? key.mirror : key.hash;
+    int first = -1;
+    if (bot_table) {
+        s->stats.probes++;
+        uint64_t entry = bot_table_probe(canonical);
+        if (entry) {
+            s->stats.hits++;
+            int score = ENTRY_SCORE(entry);
+            int bound = ENTRY_BOUND(entry);
+            if (ENTRY_DEPTH(entry) >= depth &&
+                (bound == BOUND_EXACT || (bound == BOUND_LOWER && score >= beta) ||
+                 (bound == BOUND_UPPER && score <= alpha))) {
+                s->stats.cutoffs++;
+                return score;
+            }
+            first = mirrored ? cols - 1 - ENTRY_MOVE(entry) : ENTRY_MOVE(entry);
+        }
+    }
+    
+    int alpha_start = alpha;
+    int best = -BOT_WIN;
+    int best_col = -1;
+    for (int i = first < 0 ? 0 : -1; i < cols; i++) {
+        int col = i < 0 ? first : s->order[i];
+        if (i >= 0 && col == first) continue;
+        Board child = *board;
+        int row = board_play(&child, col, side);
+        if (row < 0) continue;
+        
+        int score;
+        if (board_wins_at(&child, col, row)) score = BOT_WIN - child.moves;
+        else if (board_full(&child)) score = 0;
+        else if (depth <= 1) score = -bot_evaluate(s, &child, 1 - side);
+        else score = -bot_negamax(s, &child, bot_key_play(s, key, col, row, side), 1 - side,
+                                  depth - 1, -beta, -alpha);
+        
+        if (score > best) {
+            best = score;
+            best_col = col;
+        }
+        if (score > alpha) alpha = score;
+        if (alpha >= beta) break;
+    }
+    
+    if (bot_table && !s->stopped && best_col >= 0) {
+        int bound = best <= alpha_start ? BOUND_UPPER : best >= beta ? BOUND_LOWER : BOUND_EXACT;
+        int move = mirrored ? cols - 1 - best_col : best_col;
+        bot_table_store(canonical, ENTRY_PACK(best, depth, bound, move, s->generation));
+    }
+    return best;
+}
+
+/**
+ * Move a column to the front of an order, keeping the others' order
+ */
+static void bot_move_first(int *order, int cols, int col) {
+    int i = 0;
+    while (i < cols - 1 && order[i] != col) i++;
+    memmove(&order[1], &order[0], i * sizeof(int));
+    order[0] = col;
+}
+
+/**
+ * Choose a column for a player (0 or 1) at a level from 1 to BOT_LEVELS
+ * Returns -1 if the board is full
+ */
+int bot_best_move(const Board *board, int side, int level) {
+    BotSearch s;
+    s.variant = board_variant(board);
+    s.nodes = 0;
+    s.stopped = 0;
+    s.generation = __atomic_add_fetch(&bot_generation, 1, __ATOMIC_RELAXED);
+    memset(&s.stats, 0, sizeof(s.stats));
+    
+    // Columns by distance to the middle of the board
+    int cols = s.variant->cols;
+    int n = 0;
+    for (int dist = 0; n < cols; dist++) {
+        for (int c = 0; c < cols; c++) {
+            if (abs(2 * c - (cols - 1)) == dist) s.order[n++] = c;
+        }
+    }
+    
+    // The root has its own order: the best move so far, then the others.
+    // A move stored by an earlier search of the position goes first
+    int root[GRID_MAX_COLS];
+    memcpy(root, s.order, sizeof(root));
+    BotKey key = bot_key(board, side);
+    int mirrored = key.mirror < key.hash;
+    uint64_t canonical = mirrored ? key.mirror : key.hash;
+    uint64_t entry = bot_table ? bot_table_probe(canonical) : 0;
+    if (entry && ENTRY_MOVE(entry) < cols) {
+        bot_move_first(root, cols, mirrored ? cols - 1 - ENTRY_MOVE(entry) : ENTRY_MOVE(entry));
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &s.deadline);
+    long budget_ns = bot_levels[level - 1].budget_ms * 1000000L;
+    s.deadline.tv_sec += (s.deadline.tv_nsec + budget_ns) / 1000000000L;
+    s.deadline.tv_nsec = (s.deadline.tv_nsec + budget_ns) % 1000000000L;
+    
+    int best_col = -1;
+    int empty = cols * s.variant->rows - board->moves;
+    for (int depth = 1; depth <= bot_levels[level - 1].depth && depth <= empty; depth++) {
+        int alpha = -BOT_WIN - 1;
+        int iteration_col = -1;
+        for (int i = 0; i < cols; i++) {
+            int col = root[i];
+            Board child = *board;
+            int row = board_play(&child, col, side);
+            if (row < 0) continue;
+            
+            int score;
+            if (board_wins_at(&child, col, row)) score = BOT_WIN - child.moves;
+            else if (board_full(&child)) score = 0;
+            else if (depth <= 1) score = -bot_evaluate(&s, &child, 1 - side);
+            else score = -bot_negamax(&s, &child, bot_key_play(&s, key, col, row, side), 1 - side,
+                                      depth - 1, -BOT_WIN - 1, -alpha);
+            
+            if (s.stopped) break;
+            if (score > alpha) {
+                alpha = score;
+                iteration_col = col;
+            }
+        }
+        if (s.stopped || iteration_col < 0) break;
+        
+        // Tried first by the next iteration, and by the next search
+        best_col = iteration_col;
+        bot_move_first(root, cols, best_col);
+        if (bot_table) {
+            int move = mirrored ? cols - 1 - best_col : best_col;
+            bot_table_store(canonical, ENTRY_PACK(alpha, depth, BOUND_EXACT, move, s.generation));
+        }
+        
+        // A forced win or loss: searching deeper finds nothing better
+        if (alpha >= BOT_WIN - GRID_MAX_ROWS * GRID_MAX_COLS ||
+            alpha <= -BOT_WIN + GRID_MAX_ROWS * GRID_MAX_COLS) {
+            break;
+        }
+    }
+    
+    __atomic_add_fetch(&bot_table_stats.probes, s.stats.probes, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&bot_table_stats.hits, s.stats.hits, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&bot_table_stats.cutoffs, s.stats.cutoffs, __ATOMIC_RELAXED);
+    return best_col;
+}
+
+// ===============================
+// BOT WORKER POOL
+// ===============================
+//
+// Searches run on their own threads, never on a reactor or a game worker:
+// the game's strand queues a copy of the board, and the chosen move is
+// posted back to the strand, which plays it if the game still waits for it
+
+typedef struct BotJob {
+    struct BotJob *next;
+    int game_id;
+    unsigned tag;                      // Game.bot_tag when queued
+    int level;
+    int side;
+    Board board;
+} BotJob;
+
+typedef struct BotMoveTask {
+    StrandTask task;
+    unsigned tag;
+    int col;
+} BotMoveTask;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    BotJob *head;
+    BotJob *tail;
+    int count;
+} bot_queue = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, NULL, 0 };
+
+static unsigned bot_tags = 0;
+
+/**
+ * Play a searched move, on the strand of its game
+ */
+static void bot_move_run(StrandTask *task) {
+    BotMoveTask *move = (BotMoveTask *)task;
+    Game *game = (Game *)((char *)strand_current() - offsetof(Game, strand));
+    if (game->is_active && game->bot_tag == move->tag &&
+        game->state == GAME_IN_PROGRESS && game->current_turn == BOT_ID) {
+        handle_bot_move(game, move->col);
+    }
+    free(move);
+}
+
+static void bot_post_move(BotJob *job, int col) {
+    BotMoveTask *move = malloc(sizeof(BotMoveTask));
+    if (move) {
+        move->task.run = bot_move_run;
+        move->tag = job->tag;
+        move->col = col;
+        strand_post(&game_at(job->game_id)->strand, &move->task);
+    }
+    free(job);
+}
+
+/**
+ * Start a search if the game waits for the bot (on the game's strand)
+ * With the queue full, the bot plays at once at its lowest level
+ */
+void bot_turn(Game *game) {
+    if (game->state != GAME_IN_PROGRESS || game->current_turn != BOT_ID) return;
+    
+    BotJob *job = malloc(sizeof(BotJob));
+    if (!job) return;
+    job->next = NULL;
+    job->game_id = game->id;
+    job->tag = game->bot_tag = __atomic_add_fetch(&bot_tags, 1, __ATOMIC_RELAXED);
+    job->level = game->bot_level;
+    job->side = game->creator_id == BOT_ID ? 0 : 1;
+    job->board = game->board;
+    
+    LOCK(&bot_queue.lock, LOCK_BOT_QUEUE);
+    int queued = bot_queue.count < BOT_QUEUE_MAX;
+    if (queued) {
+        if (bot_queue.tail) bot_queue.tail->next = job;
+        else bot_queue.head = job;
+        bot_queue.tail = job;
+        bot_queue.count++;
+        pthread_cond_signal(&bot_queue.ready);
+    }
+    UNLOCK(&bot_queue.lock);
+    
+    if (!queued) {
+        bot_post_move(job, bot_best_move(&job->board, job->side, 1));
+    }
+}
+
+static void *bot_worker(void *arg) {
+    (void)arg;
+    for (;;) {
+        LOCK(&bot_queue.lock, LOCK_BOT_QUEUE);
+        while (!bot_queue.head) {
+            pthread_cond_wait(&bot_queue.ready, &bot_queue.lock);
+        }
+        BotJob *job = bot_queue.head;
+        bot_queue.head = job->next;
+        if (!bot_queue.head) bot_queue.tail = NULL;
+        bot_queue.count--;
+        UNLOCK(&bot_queue.lock);
+        
+        bot_post_move(job, bot_best_move(&job->board, job->side, job->level));
+    }
+    return NULL;
+}
+
+/**
+ * Start one bot worker per two online cores, at most BOT_MAX_WORKERS
+ * Returns the number of workers, -1 if none could be started
+ */
+int bot_pool_start(void) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int count = cores < 2 ? 1 : cores / 2 > BOT_MAX_WORKERS ? BOT_MAX_WORKERS : (int)(cores / 2);
+    
+    int started = 0;
+    for (int i = 0; i < count; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, bot_worker, NULL) != 0) {
+            perror("[SERVER] Bot thread creation error");
+            break;
+        }
+        pthread_detach(thread);
+        started++;
+    }
+    return started > 0 ? started : -1;
+}
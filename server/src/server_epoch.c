@@ -0,0 +1,92 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#include "../server.h"
+
+// ===============================
+// EPOCH BASED RECLAMATION
+// ===============================
+//
+// Readers count themselves in the parity of the epoch they entered, on a
+// counter of their own cache line. An object retired during epoch e was
+// unreachable before the epoch moved to e + 1, so only the readers of e
+// and earlier may hold it. The epoch only moves to e + 1 once no reader
+// of e - 1 is left, and the objects retired during e - 1 are released at
+// that point: a reader never waits, the writer that retires an object
+// just leaves it for a later call when readers are still around
+
+typedef struct EpochReaders {
+    unsigned long active[2];    // readers inside, by epoch parity
+} __attribute__((aligned(CACHE_LINE))) EpochReaders;
+
+static EpochReaders readers[EPOCH_SLOTS];
+static unsigned long global_epoch;
+static EpochNode *retired[2];   // by parity of the epoch they were retired in
+static pthread_mutex_t epoch_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int next_slot;
+
+static __thread int reader_slot = -1;
+static __thread int reader_parity;
+
+/**
+ * Start reading an epoch protected structure: what is loaded from it
+ * stays valid until epoch_exit(). Sections do not nest
+ */
+void epoch_enter(void) {
+    if (reader_slot < 0) {
+        reader_slot = __atomic_fetch_add(&next_slot, 1, __ATOMIC_RELAXED) % EPOCH_SLOTS;
+    }
+    
+    // The epoch may move between the load and the count: the count then
+    // went to a parity the writer may already have found empty, retry
+    for (;;) {
+        unsigned long epoch = __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&readers[reader_slot].active[epoch & 1], 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST) == epoch) {
+            reader_parity = epoch & 1;
+            return;
+        }
+        __atomic_sub_fetch(&readers[reader_slot].active[epoch & 1], 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+void epoch_exit(void) {
+    __atomic_sub_fetch(&readers[reader_slot].active[reader_parity], 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Release the objects of the previous epoch and move to the next one,
+ * if none of its readers is left (caller holds epoch_mutex)
+ */
+static void epoch_try_advance(void) {
+    unsigned long epoch = global_epoch;
+    int previous = (epoch - 1) & 1;
+    for (int i = 0; i < EPOCH_SLOTS; i++) {
+        if (__atomic_load_n(&readers[i].active[previous], __ATOMIC_SEQ_CST) != 0) return;
+    }
+    
+    EpochNode *node = retired[previous];
+    retired[previous] = NULL;
+    while (node) {
+        EpochNode *next = node->next;
+        node->release(node);
+        node = next;
+    }
+    __atomic_store_n(&global_epoch, epoch + 1, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * Hand over an object that was just made unreachable: it is released
+ * once every reader that could have loaded it has left
+ */
+void epoch_retire(EpochNode *node) {
+    LOCK(&epoch_mutex, LOCK_EPOCH);
+    node->next = retired[global_epoch & 1];
+    retired[global_epoch & 1] = node;
+    epoch_try_advance();
+    UNLOCK(&epoch_mutex);
+}
@@ -10,42 +10,197 @@
 // ==============================
 // CONNECT 4 GAME LOGIC
 // ==============================
+//
+// Every board variant gets its own engine, generated below with its
+// geometry as constants: the shifts between neighbours are immediates,
+// the connect loops are unrolled, and boards that fit in 64 bits (spare
+// row included) are handled with 64-bit words
+
+// name, columns, rows, pieces in a row that win, bitboard word
+#define BOARD_VARIANTS(X)                   \
+    X(7x6, 7, 6, 4, uint64_t)               \
+    X(8x7, 8, 7, 4, uint64_t)               \
+    X(9x7, 9, 7, 5, Bitboard)
+
+// Distances in bits between two neighbours: vertical, horizontal,
+// diagonal and anti-diagonal
+#define BOARD_STEPS(ROWS) { 1, (ROWS) + 1, (ROWS) + 2, (ROWS) }
+
+#define BOARD_ENGINE(ID, COLS, ROWS, CONNECT, WORD)                             \
+_Static_assert(COLS <= GRID_MAX_COLS && ROWS <= GRID_MAX_ROWS,                  \
+               "board " #ID " exceeds the largest grid");                       \
+_Static_assert(COLS * (ROWS + 1) <= 8 * (int)sizeof(WORD),                      \
+               "board " #ID " does not fit in its bitboard word");              \
+                                                                                \
+static int play_##ID(Board *board, int col, int side) {                         \
+    if (col < 0 || col >= COLS || board->heights[col] >= ROWS) return -1;       \
+                                                                                \
+    int row = board->heights[col]++;                                            \
+    board->pieces[side] |= (Bitboard)1 << (col * (ROWS + 1) + row);             \
+    board->moves++;                                                             \
+    return row;                                                                 \
+}                                                                               \
+                                                                                \
+static int wins_##ID(const Board *board, int side) {                            \
+    static const int steps[] = BOARD_STEPS(ROWS);                               \
+    WORD pieces = (WORD)board->pieces[side];                                    \
+                                                                                \
+    for (int i = 0; i < 4; i++) {                                               \
+        WORD run = pieces;                                                      \
+        for (int k = 1; k < CONNECT; k++) run &= pieces >> (k * steps[i]);      \
+        if (run) return 1;                                                      \
+    }                                                                           \
+    return 0;                                                                   \
+}                                                                               \
+                                                                                \
+static int wins_at_##ID(const Board *board, int col, int row) {                 \
+    static const int steps[] = BOARD_STEPS(ROWS);                               \
+    WORD bit = (WORD)1 << (col * (ROWS + 1) + row);                             \
+    WORD pieces = (WORD)((board->pieces[0] & bit) ? board->pieces[0]            \
+                                                  : board->pieces[1]);          \
+                                                                                \
+    for (int i = 0; i < 4; i++) {                                               \
+        int count = 1;                                                          \
+        for (WORD b = bit << steps[i]; count < CONNECT && (pieces & b);         \
+             b <<= steps[i]) count++;                                           \
+        for (WORD b = bit >> steps[i]; count < CONNECT && (pieces & b);         \
+             b >>= steps[i]) count++;                                           \
+        if (count >= CONNECT) return 1;                                         \
+    }                                                                           \
+    return 0;                                                                   \
+}
+
+BOARD_VARIANTS(BOARD_ENGINE)
+
+#define BOARD_VARIANT(ID, COLS, ROWS, CONNECT, WORD) \
+    { #ID, COLS, ROWS, CONNECT, play_##ID, wins_##ID, wins_at_##ID },
+
+// The first one is the classic board, played when none is asked for
+const Variant variants[] = { BOARD_VARIANTS(BOARD_VARIANT) };
+const int variant_count = sizeof(variants) / sizeof(variants[0]);
 
 /**
- * Initialize the grid
+ * Index of a player's bitboard
  */
-void init_grid(Game *game) {
-    for (int r = 0; r < GRID_ROWS; r++) {
-        for (int c = 0; c < GRID_COLS; c++) {
-            game->grid[r][c] = EMPTY;
-        }
+static int board_side(char piece) {
+    return piece == PLAYER1 ? 0 : 1;
+}
+
+/**
+ * Find a variant by name
+ * Returns its index, -1 if there is none
+ */
+int variant_find(const char *name) {
+    for (int i = 0; i < variant_count; i++) {
+        if (strcmp(variants[i].name, name) == 0) return i;
     }
+    return -1;
+}
+
+const Variant *board_variant(const Board *board) {
+    return &variants[board->variant];
+}
+
+/**
+ * Empty the board, for a variant
+ */
+void board_init(Board *board, int variant) {
+    memset(board, 0, sizeof(*board));
+    board->variant = variant;
+}
+
+/**
+ * Drop a piece of a player (0 or 1) in a column
+ * Returns the row where it lands, counted from the bottom, -1 if the
+ * column does not exist or is full
+ */
+int board_play(Board *board, int col, int side) {
+    return board_variant(board)->play(board, col, side);
+}
+
+/**
+ * Check whether a player has a winning line anywhere on the board
+ */
+int board_wins(const Board *board, int side) {
+    return board_variant(board)->wins(board, side);
+}
+
+/**
+ * Check for a winning line through one cell (row counted from the
+ * bottom), for the player whose piece is there: only the last move can
+ * complete a line, so only its neighbours are looked at
+ */
+int board_wins_at(const Board *board, int col, int row) {
+    return board_variant(board)->wins_at(board, col, row);
+}
+
+/**
+ * Check if every cell holds a piece
+ */
+int board_full(const Board *board) {
+    const Variant *v = board_variant(board);
+    return board->moves == v->cols * v->rows;
+}
+
+/**
+ * Symbol of a cell, rows counted from the top as they are shown
+ */
+char board_cell(const Board *board, int row, int col) {
+    int rows = board_variant(board)->rows;
+    Bitboard bit = (Bitboard)1 << (col * (rows + 1) + (rows - 1 - row));
+    if (board->pieces[0] & bit) return PLAYER1;
+    if (board->pieces[1] & bit) return PLAYER2;
+    return EMPTY;
+}
+
+/**
+ * Initialize the grid, keeping the game's variant
+ */
+void init_grid(Game *game) {
+    board_init(&game->board, game->board.variant);
 }
 
 /**
  * Format the grid to string
  */
 void format_grid(Game *game, char *buffer, size_t size) {
+    const Variant *v = board_variant(&game->board);
     char *ptr = buffer;
     int remaining = size;
     int written;
     
-    written = snprintf(ptr, remaining, "\n  1 2 3 4 5 6 7\n");
+    written = snprintf(ptr, remaining, "\n ");
     ptr += written; remaining -= written;
-    written = snprintf(ptr, remaining, " +---------------+\n");
+    for (int c = 0; c < v->cols; c++) {
+        written = snprintf(ptr, remaining, " %d", c + 1);
+        ptr += written; remaining -= written;
+    }
+    written = snprintf(ptr, remaining, "\n +-");
+    ptr += written; remaining -= written;
+    for (int c = 0; c < v->cols; c++) {
+        written = snprintf(ptr, remaining, "--");
+        ptr += written; remaining -= written;
+    }
+    written = snprintf(ptr, remaining, "+\n");
     ptr += written; remaining -= written;
     
-    for (int r = 0; r < GRID_ROWS; r++) {
+    for (int r = 0; r < v->rows; r++) {
         written = snprintf(ptr, remaining, " | ");
         ptr += written; remaining -= written;
-        for (int c = 0; c < GRID_COLS; c++) {
-            written = snprintf(ptr, remaining, "%c ", game->grid[r][c]);
+        for (int c = 0; c < v->cols; c++) {
+            written = snprintf(ptr, remaining, "%c ", board_cell(&game->board, r, c));
             ptr += written; remaining -= written;
         }
         written = snprintf(ptr, remaining, "|\n");
         ptr += written; remaining -= written;
     }
-    written = snprintf(ptr, remaining, " +---------------+\n");
+    written = snprintf(ptr, remaining, " +-");
+    ptr += written; remaining -= written;
+    for (int c = 0; c < v->cols; c++) {
+        written = snprintf(ptr, remaining, "--");
+        ptr += written; remaining -= written;
+    }
+    written = snprintf(ptr, remaining, "+\n");
 }
 
 /**
@@ -53,54 +208,24 @@ void format_grid(Game *game, char *buffer, size_t size) {
  * Returns the row where piece is dropped
  */
 int drop_piece(Game *game, int col, char piece) {
-    if (col < 0 || col >= GRID_COLS) return -1;
-    
-    for (int r = GRID_ROWS - 1; r >= 0; r--) {
-        if (game->grid[r][col] == EMPTY) {
-            game->grid[r][col] = piece;
-            return r;
-        }
-    }
-    return -1;
-}
-
-/**
- * Check for a win in a direction
- */
-int check_direction(Game *game, int row, int col, int dr, int dc, char piece) {
-    int count = 0;
-    for (int i = 0; i < 4; i++) {
-        int r = row + i * dr;
-        int c = col + i * dc;
-        if (r < 0 || r >= GRID_ROWS || c < 0 || c >= GRID_COLS) break;
-        if (game->grid[r][c] == piece) count++;
-        else break;
-    }
-    return count >= 4;
+    int row = board_play(&game->board, col, board_side(piece));
+    return row < 0 ? -1 : board_variant(&game->board)->rows - 1 - row;
 }
 
 /**
  * Check if a player has won
+ * Scanning every line of the bitboards takes a few shifts per
+ * direction, less than looking only around the last move does (see
+ * bench/bench_move.c)
  */
 int check_winner(Game *game, char piece) {
-    for (int r = 0; r < GRID_ROWS; r++) {
-        for (int c = 0; c < GRID_COLS; c++) {
-            if (check_direction(game, r, c, 0, 1, piece)) return 1;
-            if (check_direction(game, r, c, 1, 0, piece)) return 1;
-            if (check_direction(game, r, c, 1, 1, piece)) return 1;
-            if (check_direction(game, r, c, 1, -1, piece)) return 1;
-        }
-    }
-    return 0;
+    return board_wins(&game->board, board_side(piece));
 }
 
 /**
  * Check if the grid is full (in draw case)
  */
 int is_grid_full(Game *game) {
-    for (int c = 0; c < GRID_COLS; c++) {
-        if (game->grid[0][c] == EMPTY) return 0;
-    }
-    return 1;
+    return board_full(&game->board);
 }
 
@@ -10,53 +10,107 @@
 // =============================
 // GAME MANAGEMENT
 // =============================
+//
+// These run on the strand of the game they touch, creation included
+// (see client_run): the game state needs no lock. What the other
+// threads show of a game (list, status, grid) is copied with
+// game_snapshot(), a seqlock read: the writer makes seq odd for the
+// duration of a change, and a reader retries when it saw seq odd or
+// changed across its copy
 
 /**
- * Create a new game
+ * Open a game in a slot taken from the game table, on the slot's strand:
+ * waiting for an opponent, or already in progress against the bot when
+ * a level is given
+ * Returns -1 when there is no slot (the table is full)
  */
-int create_game(int creator_id) {
-    pthread_mutex_lock(&games_mutex);
-    int game_id = -1;
-    for (int i = 0; i < MAX_GAMES; i++) {
-        if (!games[i].is_active) {
-            game_id = i;
-            break;
-        }
-    }
-    if (game_id == -1) {
-        pthread_mutex_unlock(&games_mutex);
+static int game_open(int game_id, int creator_id, int variant, int bot_level) {
+    if (game_id < 0) {
         return -1;
     }
     
-    Game *game = &games[game_id];
-    game->id = game_id;
-    game->state = GAME_WAITING;
+    Game *game = game_at(game_id);
+    game_write_begin(game);
+    game->state = bot_level ? GAME_IN_PROGRESS : GAME_WAITING;
     game->creator_id = creator_id;
-    game->opponent_id = -1;
+    game->opponent_id = bot_level ? BOT_ID : -1;
     game->current_turn = creator_id;
     game->winner_id = 0;
+    game->bot_level = bot_level;
+    board_init(&game->board, variant);
     game->is_active = 1;
-    game->join_requests = NULL;
-    pthread_mutex_unlock(&games_mutex);
-    init_grid(game);
-    pthread_mutex_init(&game->game_mutex, NULL);
+    game_write_end(game);
     
-    pthread_mutex_lock(&clients_mutex);
-    Client *creator = get_client_by_id(creator_id);
+    Client *creator = lock_client_by_id(creator_id);
     if (creator) {
         creator->current_game_id = game_id;
+        unlock_client(creator);
     }
-    pthread_mutex_unlock(&clients_mutex);
     return game_id;
 }
 
+/**
+ * Create a new game, played on a board variant
+ */
+int create_game(int game_id, int creator_id, int variant) {
+    return game_open(game_id, creator_id, variant, 0);
+}
+
+/**
+ * Create a game against the bot at a level: the creator plays X and
+ * moves first
+ */
+int create_bot_game(int game_id, int creator_id, int variant, int level) {
+    return game_open(game_id, creator_id, variant, level);
+}
+
 /**
  * Get game by ID
  */
 Game* get_game_by_id(int game_id) {
-    if (game_id < 0 || game_id >= MAX_GAMES) return NULL;
-    if (!games[game_id].is_active) return NULL;
-    return &games[game_id];
+    if (game_id < 0 || game_id >= table_capacity(&game_table)) return NULL;
+    Game *game = game_at(game_id);
+    return game->is_active ? game : NULL;
+}
+
+/**
+ * Start a change of the fields other threads copy; only the game's
+ * strand makes one
+ */
+void game_write_begin(Game *game) {
+    __atomic_store_n(&game->seq, game->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void game_write_end(Game *game) {
+    __atomic_store_n(&game->seq, game->seq + 1, __ATOMIC_RELEASE);
+    lobby_update(game);
+}
+
+/**
+ * Copy the board, state, turn, players and winner of a game from any
+ * thread, without locking
+ * Returns -1 if the game does not exist
+ */
+int game_snapshot(int game_id, Game *copy) {
+    if (game_id < 0 || game_id >= table_capacity(&game_table)) return -1;
+    Game *game = game_at(game_id);
+    
+    for (;;) {
+        unsigned seq = __atomic_load_n(&game->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) continue;
+        memcpy(&copy->board, &game->board, sizeof(copy->board));
+        copy->state = game->state;
+        copy->current_turn = game->current_turn;
+        copy->is_active = game->is_active;
+        copy->id = game->id;
+        copy->creator_id = game->creator_id;
+        copy->opponent_id = game->opponent_id;
+        copy->winner_id = game->winner_id;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&game->seq, __ATOMIC_RELAXED) == seq) break;
+    }
+    return copy->is_active ? 0 : -1;
 }
 
 /**
@@ -66,36 +120,46 @@ int add_join_request(int game_id, int requester_id) {
     Game *game = get_game_by_id(game_id);
     if (!game) return -1;
     
-    pthread_mutex_lock(&game->game_mutex);
-    
     if (game->state != GAME_WAITING) {
-        pthread_mutex_unlock(&game->game_mutex);
         return -2;
     }
     
     if (game->creator_id == requester_id) {
-        pthread_mutex_unlock(&game->game_mutex);
         return -3;
     }
     
-    JoinRequest *req = game->join_requests;
-    while (req) {
-        if (req->requester_id == requester_id && req->processed == 0) {
-            pthread_mutex_unlock(&game->game_mutex);
-            return -4;
-        }
-        req = req->next;
+    int result = joinq_add(&game->join_requests, requester_id);
+    if (result == -2 && purge_join_requests(game) > 0) {
+        result = joinq_add(&game->join_requests, requester_id);
+    }
+    switch (result) {
+        case -1: return -4;
+        case -2: return -5;
     }
-    
-    JoinRequest *new_req = malloc(sizeof(JoinRequest));
-    new_req->requester_id = requester_id;
-    new_req->processed = 0;
-    new_req->next = game->join_requests;
-    game->join_requests = new_req;
-    pthread_mutex_unlock(&game->game_mutex);
     return 0;
 }
 
+/**
+ * Drop the requests of clients that are gone: their disconnection
+ * withdraws them, but only the latest CLIENT_JOIN_TRACK of each client
+ * Returns how many were dropped
+ */
+int purge_join_requests(Game *game) {
+    JoinQueue *q = &game->join_requests;
+    int purged = 0;
+    int e = q->head;
+    while (e >= 0) {
+        int next = q->entries[e].next;
+        int requester_id = q->entries[e].requester_id;
+        if (!get_client_by_id(requester_id)) {
+            joinq_remove(q, requester_id);
+            purged++;
+        }
+        e = next;
+    }
+    return purged;
+}
+
 /**
  * Process a join request
  */
@@ -103,41 +167,29 @@ int process_join_request(int game_id, int requester_id, int accept) {
     Game *game = get_game_by_id(game_id);
     if (!game) return -1;
     
-    pthread_mutex_lock(&game->game_mutex);
-    
     if (game->state != GAME_WAITING) {
-        pthread_mutex_unlock(&game->game_mutex);
         return -2;
     }
     
-    JoinRequest *req = game->join_requests;
-    while (req) {
-        if (req->requester_id == requester_id && req->processed == 0) {
-            if (accept) {
-                req->processed = 1; 
-            } else {
-                req->processed = -1; 
-            }
-            if (accept) {
-                game->opponent_id = requester_id;
-                game->state = GAME_IN_PROGRESS;
-                game->current_turn = game->creator_id;
-                pthread_mutex_lock(&clients_mutex);
-                Client *opponent = get_client_by_id(requester_id);
-
-                if (opponent) {
-                    opponent->current_game_id = game_id;
-                }
-
-                pthread_mutex_unlock(&clients_mutex);
-            }
-            pthread_mutex_unlock(&game->game_mutex);
-            return 0;
+    if (joinq_remove(&game->join_requests, requester_id) < 0) {
+        return -3;
+    }
+    
+    if (accept) {
+        game_write_begin(game);
+        game->opponent_id = requester_id;
+        game->state = GAME_IN_PROGRESS;
+        game->current_turn = game->creator_id;
+        game_write_end(game);
+        Client *opponent = lock_client_by_id(requester_id);
+
+        if (opponent) {
+            opponent->current_game_id = game_id;
+            unlock_client(opponent);
         }
-        req = req->next;
+
     }
-    pthread_mutex_unlock(&game->game_mutex);
-    return -3;
+    return 0;
 }
 
 /**
@@ -147,23 +199,20 @@ int make_move(int game_id, int player_id, int column) {
     Game *game = get_game_by_id(game_id);
     if (!game) return -1;
     
-    pthread_mutex_lock(&game->game_mutex);
-    
     if (game->state != GAME_IN_PROGRESS) {
-        pthread_mutex_unlock(&game->game_mutex);
         return -2;
     }
     
     if (game->current_turn != player_id) {
-        pthread_mutex_unlock(&game->game_mutex);
         return -3;
     }
     
     char piece = (player_id == game->creator_id) ? PLAYER1 : PLAYER2;
+    game_write_begin(game);
     int row = drop_piece(game, column, piece);
     
     if (row < 0) {
-        pthread_mutex_unlock(&game->game_mutex);
+        game_write_end(game);
         return -4;
     }
     
@@ -176,7 +225,7 @@ int make_move(int game_id, int player_id, int column) {
     } else {
         game->current_turn = (player_id == game->creator_id) ? game->opponent_id : game->creator_id;
     }
-    pthread_mutex_unlock(&game->game_mutex);
+    game_write_end(game);
     return 0;
 }
 
@@ -187,25 +236,23 @@ void cleanup_game(int game_id) {
     Game *game = get_game_by_id(game_id);
     if (!game) return;
     
-    pthread_mutex_lock(&game->game_mutex);
+    joinq_clear(&game->join_requests);
     
-    JoinRequest *req = game->join_requests;
-    while (req) {
-        JoinRequest *next = req->next;
-        free(req);
-        req = next;
-    }
-    game->join_requests = NULL;
-    
-    pthread_mutex_lock(&clients_mutex);
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (clients[i].current_game_id == game_id) {
-            clients[i].current_game_id = -1;
+    // Only the players ever point at the game; their locks are taken
+    // one at a time
+    int players[2] = { game->creator_id, game->opponent_id };
+    for (int i = 0; i < 2; i++) {
+        Client *player = lock_client_by_id(players[i]);
+        if (player) {
+            if (player->current_game_id == game_id) player->current_game_id = -1;
+            unlock_client(player);
         }
     }
-    pthread_mutex_unlock(&clients_mutex);
+    game_write_begin(game);
     game->is_active = 0;
-    pthread_mutex_unlock(&game->game_mutex);
+    game_write_end(game);
+    timer_cancel(&game->turn_timer);
+    table_free(&game_table, game_id);
 }
 
 /**
@@ -215,11 +262,19 @@ void reset_game_for_rematch(int game_id) {
     Game *game = get_game_by_id(game_id);
     if (!game) return;
     
-    pthread_mutex_lock(&game->game_mutex);
+    game_write_begin(game);
     init_grid(game);
     game->state = GAME_IN_PROGRESS;
     game->winner_id = 0;
     game->current_turn = (game->current_turn == game->creator_id) ? game->opponent_id : game->creator_id;
-    pthread_mutex_unlock(&game->game_mutex);
+    game_write_end(game);
+}
+
+/**
+ * Start the abandoned game timeout of a game that just (re)started
+ */
+void game_turn_start(Game *game) {
+    __atomic_store_n(&game->turn_started, timer_now(), __ATOMIC_RELAXED);
+    timer_arm(&game->turn_timer, TIMER_TICKS(TURN_TIMEOUT_MS), game->id);
 }
 
@@ -21,10 +21,13 @@ void handle_help(Client *client) {
         "║    help              - Show this message                       ║\n"
         "║    list              - List available games                    ║\n"
         "║    status            - Current player status                   ║\n"
+        "║    stats             - Server queue and bot table counters     ║\n"
         "║    quit              - Disconnect from server                  ║\n"
         "║                                                                ║\n"
         "║  GAME MANAGEMENT:                                              ║\n"
         "║    create            - Create a new game                       ║\n"
+        "║    create <board>    - Play on 8x7, or 9x7 with 5 in a row     ║\n"
+        "║    play bot <1-5>    - Play against the server's bot           ║\n"
         "║    join <id>         - Request to join game <id>               ║\n"
         "║    requests          - View join requests                      ║\n"
         "║    accept <username> - Accept request from <username>          ║\n"
@@ -32,58 +35,15 @@ void handle_help(Client *client) {
         "║    leave             - Leave current game                      ║\n"
         "║                                                                ║\n"
         "║  DURING GAME:                                                  ║\n"
-        "║    move <1-7>        - Drop piece in column 1-7                ║\n"
+        "║    move <column>     - Drop piece in a column                  ║\n"
         "║    grid              - Show game grid                          ║\n"
         "║    rematch           - Propose/accept rematch                  ║\n"
         "╚════════════════════════════════════════════════════════════════╝\n\n");
-    send(client->socket, msg, strlen(msg), 0);
+    client_send(client, msg, strlen(msg));
 }
 
 void handle_list(Client *client) {
-    char msg[BUFFER_SIZE];
-    char *ptr = msg;
-    int remaining = sizeof(msg);
-    int written;
-    
-    written = snprintf(ptr, remaining,
-        "\n╔═══════════════════════════════════════════════════════════════╗\n"
-        "║                      GAME LIST                                ║\n"
-        "╠═══════════════════════════════════════════════════════════════╣\n");
-    ptr += written; remaining -= written;
-    
-    pthread_mutex_lock(&games_mutex);
-    
-    int found = 0;
-    for (int i = 0; i < MAX_GAMES; i++) {
-        if (games[i].is_active) {
-            found = 1;
-            const char *state_str;
-            switch (games[i].state) {
-                case GAME_WAITING: state_str = "Waiting"; break;
-                case GAME_IN_PROGRESS: state_str = "In progress"; break;
-                case GAME_FINISHED: state_str = "Finished"; break;
-                default: state_str = "Created"; break;
-            }
-            const char *creator_name = get_username(games[i].creator_id);
-            written = snprintf(ptr, remaining,
-                "║  Game #%-3d  |  Creator: %-12s |  Status: %-12s  ║\n",
-                games[i].id, creator_name, state_str);
-            ptr += written; remaining -= written;
-        }
-    }
-    
-    pthread_mutex_unlock(&games_mutex);
-    
-    if (!found) {
-        written = snprintf(ptr, remaining,
-            "║             No games available                                 ║\n");
-        ptr += written; remaining -= written;
-    }
-    
-    snprintf(ptr, remaining,
-        "╚═══════════════════════════════════════════════════════════════╝\n\n");
-    
-    send(client->socket, msg, strlen(msg), 0);
+    lobby_send(client);
 }
 
 void handle_status(Client *client) {
@@ -95,13 +55,13 @@ void handle_status(Client *client) {
             "           Use 'create' to create a game or 'join <id>' to join one.\n\n",
             client->username);
     } else {
-        Game *game = get_game_by_id(client->current_game_id);
-        if (game) {
+        Game game;
+        if (game_snapshot(client->current_game_id, &game) == 0) {
             const char *state_str;
-            switch (game->state) {
+            switch (game.state) {
                 case GAME_WAITING: state_str = "Waiting for opponent"; break;
                 case GAME_IN_PROGRESS: 
-                    state_str = (game->current_turn == client->id) ? "In progress - IT'S YOUR TURN!" : "In progress - Opponent's turn";
+                    state_str = (game.current_turn == client->id) ? "In progress - IT'S YOUR TURN!" : "In progress - Opponent's turn";
                     break;
                 case GAME_FINISHED: state_str = "Finished"; break;
                 default: state_str = "Created"; break;
@@ -116,11 +76,30 @@ void handle_status(Client *client) {
                 client->username);
         }
     }
-    send(client->socket, msg, strlen(msg), 0);
+    client_send(client, msg, strlen(msg));
+}
+
+static void send_unknown_board(Client *client) {
+    char msg[BUFFER_SIZE];
+    char *ptr = msg;
+    int remaining = sizeof(msg);
+    int written = snprintf(ptr, remaining, "\n[ERROR] Unknown board. Available boards:");
+    ptr += written; remaining -= written;
+    for (int i = 0; i < variant_count; i++) {
+        written = snprintf(ptr, remaining, " %s (%d in a row)%s", variants[i].name,
+                           variants[i].connect, i < variant_count - 1 ? "," : ".\n\n");
+        ptr += written; remaining -= written;
+    }
+    client_send(client, msg, strlen(msg));
 }
 
-void handle_create(Client *client) {
+void handle_create(Client *client, int variant) {
     char msg[BUFFER_SIZE];
+    if (variant < 0 || variant >= variant_count) {
+        send_unknown_board(client);
+        return;
+    }
+    
     if (client->current_game_id >= 0) {
         Game *current = get_game_by_id(client->current_game_id);
         if (current && current->state != GAME_FINISHED) {
@@ -128,36 +107,122 @@ void handle_create(Client *client) {
                 "\n[ERROR] You are already in an active game (Game #%d).\n"
                 "           Use 'leave' to leave before creating a new one.\n\n",
                 client->current_game_id);
-            send(client->socket, msg, strlen(msg), 0);
+            client_send(client, msg, strlen(msg));
             return;
         }
     }
     
-    int game_id = create_game(client->id);
+    // The slot client_run took, and whose strand this runs on
+    int game_id = create_game(client->opening_game_id, client->id, variant);
     
     if (game_id < 0) {
         snprintf(msg, sizeof(msg),
             "\n[ERROR] Cannot create game. Server is full.\n\n");
     } else {
+        char board[64];
+        snprintf(board, sizeof(board), "%s, %d in a row",
+                 variants[variant].name, variants[variant].connect);
         snprintf(msg, sizeof(msg),
             "\n╔═══════════════════════════════════════════════════════════════╗\n"
             "║                     GAME CREATED!                              ║\n"
             "╠═══════════════════════════════════════════════════════════════╣\n"
             "║  Game ID: %-3d                                                 ║\n"
+            "║  Board: %-54s║\n"
             "║  Status: Waiting for an opponent...                            ║\n"
             "║                                                                ║\n"
             "║  Other players can join with: join %d                          ║\n"
             "║  Use 'requests' to see join requests                           ║\n"
             "╚═══════════════════════════════════════════════════════════════╝\n\n",
-            game_id, game_id);
+            game_id, board, game_id);
+        
+        client->opening_game_id = -1;
+        GameEventMsg event;
+        proto_game_event(&event, GAME_EVENT_CREATED, game_id, client->id, -1);
+        
+        Response r;
+        response_init(&r);
+        response_string(&r, msg);
+        client_send_event(client, &r, MSG_GAME_EVENT, &event, sizeof(event));
         
         char broadcast_msg[BUFFER_SIZE];
         snprintf(broadcast_msg, sizeof(broadcast_msg),
             "\n[NOTICE] %s created game #%d. Use 'join %d' to participate!\n\n",
             client->username, game_id, game_id);
-        broadcast_except(client->id, broadcast_msg);
+        broadcast_event_except(client->id, broadcast_msg, MSG_GAME_EVENT, &event, sizeof(event));
+        return;
     }
-    send(client->socket, msg, strlen(msg), 0);
+    client_send(client, msg, strlen(msg));
+}
+
+/**
+ * Start a game against the bot: no lobby, the player moves first
+ */
+void handle_play_bot(Client *client, int level, int variant) {
+    char msg[BUFFER_SIZE];
+    if (level < 1 || level > BOT_LEVELS) {
+        snprintf(msg, sizeof(msg),
+            "\n[ERROR] Usage: play bot <1-%d> [board]\n\n", BOT_LEVELS);
+        client_send(client, msg, strlen(msg));
+        return;
+    }
+    if (variant < 0 || variant >= variant_count) {
+        send_unknown_board(client);
+        return;
+    }
+    
+    if (client->current_game_id >= 0) {
+        Game *current = get_game_by_id(client->current_game_id);
+        if (current && current->state != GAME_FINISHED) {
+            snprintf(msg, sizeof(msg),
+                "\n[ERROR] You are already in an active game (Game #%d).\n"
+                "           Use 'leave' to leave before starting a new one.\n\n",
+                client->current_game_id);
+            client_send(client, msg, strlen(msg));
+            return;
+        }
+    }
+    
+    int game_id = create_bot_game(client->opening_game_id, client->id, variant, level);
+    if (game_id < 0) {
+        snprintf(msg, sizeof(msg),
+            "\n[ERROR] Cannot create game. Server is full.\n\n");
+        client_send(client, msg, strlen(msg));
+        return;
+    }
+    client->opening_game_id = -1;
+    Game *game = game_at(game_id);
+    game_turn_start(game);
+    
+    char board[64];
+    snprintf(board, sizeof(board), "%s, %d in a row",
+             variants[variant].name, variants[variant].connect);
+    char grid_msg[BUFFER_SIZE];
+    format_grid(game, grid_msg, sizeof(grid_msg));
+    snprintf(msg, sizeof(msg),
+        "\n╔═══════════════════════════════════════════════════════════════╗\n"
+        "║                 GAME AGAINST THE BOT!                          ║\n"
+        "╠═══════════════════════════════════════════════════════════════╣\n"
+        "║  Game ID: %-3d                                                 ║\n"
+        "║  Board: %-54s║\n"
+        "║  Bot level: %d of %d                                            ║\n"
+        "║  You play with: X (first turn)                                 ║\n"
+        "║  Use 'move <1-%d>' to make your move!                          ║\n"
+        "╚═══════════════════════════════════════════════════════════════╝\n\n",
+        game_id, board, level, BOT_LEVELS, variants[variant].cols);
+    
+    GameEventMsg event;
+    proto_game_event(&event, GAME_EVENT_STARTED, game_id, client->id, BOT_ID);
+    Response r;
+    response_init(&r);
+    response_string(&r, msg);
+    response_string(&r, grid_msg);
+    client_send_event(client, &r, MSG_GAME_EVENT, &event, sizeof(event));
+    
+    char broadcast_msg[BUFFER_SIZE];
+    snprintf(broadcast_msg, sizeof(broadcast_msg),
+        "\n[NOTICE] Game #%d between %s and " BOT_NAME " has started!\n\n",
+        game_id, client->username);
+    broadcast_event_except(client->id, broadcast_msg, MSG_GAME_EVENT, &event, sizeof(event));
 }
 
 void handle_join(Client *client, int game_id) {
@@ -168,7 +233,7 @@ void handle_join(Client *client, int game_id) {
             snprintf(msg, sizeof(msg),
                 "\n[ERROR] You are already in an active game (Game #%d).\n\n",
                 client->current_game_id);
-            send(client->socket, msg, strlen(msg), 0);
+            client_send(client, msg, strlen(msg));
             return;
         }
     }
@@ -177,6 +242,7 @@ void handle_join(Client *client, int game_id) {
     
     switch (result) {
         case 0:
+            client->join_games[client->join_count++ % CLIENT_JOIN_TRACK] = game_id;
             snprintf(msg, sizeof(msg),
                 "\n[OK] Join request sent for game #%d.\n"
                 "     Waiting for the creator to accept your request...\n\n",
@@ -189,7 +255,13 @@ void handle_join(Client *client, int game_id) {
                     "\n[REQUEST] %s wants to join your game #%d!\n"
                     "           Use 'accept %s' or 'reject %s'\n\n",
                     client->username, game_id, client->username, client->username);
-                send_to_client(game->creator_id, notify);
+                
+                Response r;
+                response_init(&r);
+                response_string(&r, notify);
+                GameEventMsg event;
+                proto_game_event(&event, GAME_EVENT_JOIN_REQUEST, game_id, client->id, -1);
+                send_event_to_client(game->creator_id, &r, MSG_GAME_EVENT, &event, sizeof(event));
             }
             break;
         case -1:
@@ -208,11 +280,15 @@ void handle_join(Client *client, int game_id) {
             snprintf(msg, sizeof(msg),
                 "\n[ERROR] You have already sent a request for this game.\n\n");
             break;
+        case -5:
+            snprintf(msg, sizeof(msg),
+                "\n[ERROR] Game #%d has too many pending requests. Try again later.\n\n", game_id);
+            break;
         default:
             snprintf(msg, sizeof(msg),
                 "\n[ERROR] Unknown error.\n\n");
     }
-    send(client->socket, msg, strlen(msg), 0);
+    client_send(client, msg, strlen(msg));
 }
 
 void handle_requests(Client *client) {
@@ -221,7 +297,7 @@ void handle_requests(Client *client) {
     if (client->current_game_id < 0) {
         snprintf(msg, sizeof(msg),
             "\n[ERROR] You have not created any game.\n\n");
-        send(client->socket, msg, strlen(msg), 0);
+        client_send(client, msg, strlen(msg));
         return;
     }
     
@@ -229,11 +305,10 @@ void handle_requests(Client *client) {
     if (!game || game->creator_id != client->id) {
         snprintf(msg, sizeof(msg),
             "\n[ERROR] You are not the creator of this game.\n\n");
-        send(client->socket, msg, strlen(msg), 0);
+        client_send(client, msg, strlen(msg));
         return;
     }
     
-    pthread_mutex_lock(&game->game_mutex);
     char *ptr = msg;
     int remaining = sizeof(msg);
     int written;
@@ -243,130 +318,188 @@ void handle_requests(Client *client) {
         "╠═══════════════════════════════════════════════════════════════╣\n");
     ptr += written; remaining -= written;
     
-    int found = 0;
-    JoinRequest *req = game->join_requests;
-    while (req) {
-        if (req->processed == 0) {
-            found = 1;
-            const char *requester_name = get_username(req->requester_id);
-            written = snprintf(ptr, remaining,
-                "║  - %s (pending)                                                \n",
-                requester_name);
-            ptr += written; remaining -= written;
-        }
-        req = req->next;
+    purge_join_requests(game);
+    JoinQueue *q = &game->join_requests;
+    for (int e = q->head; e >= 0 && remaining > 2 * LIST_LINE_MAX; e = q->entries[e].next) {
+        const char *requester_name = get_username(q->entries[e].requester_id);
+        written = snprintf(ptr, remaining,
+            "║  - %s (pending)                                                \n",
+            requester_name);
+        ptr += written; remaining -= written;
     }
     
-    if (!found) {
+    if (q->count == 0) {
         written = snprintf(ptr, remaining,
             "║             No pending requests                                 ║\n");
         ptr += written; remaining -= written;
     }
     
-    pthread_mutex_unlock(&game->game_mutex);
     snprintf(ptr, remaining,
         "╚═══════════════════════════════════════════════════════════════╝\n\n");
     
-    send(client->socket, msg, strlen(msg), 0);
+    client_send(client, msg, strlen(msg));
 }
 
-void handle_accept_reject(Client *client, const char *username, int accept) {
+// Static pieces of the game responses: only usernames, column and grid
+// are filled per message, everything else is referenced in place
+static const char column_digits[] = "123456789";
+
+static const char *symbol_text(char symbol) {
+    return symbol == PLAYER1 ? "X" : "O";
+}
+
+/**
+ * The game whose requests a client may accept or reject, NULL (with
+ * the error sent) if it is not the creator of one
+ */
+static Game *accept_reject_game(Client *client) {
     char msg[BUFFER_SIZE];
     
     if (client->current_game_id < 0) {
         snprintf(msg, sizeof(msg),
             "\n[ERROR] You don't have an active game.\n\n");
-        send(client->socket, msg, strlen(msg), 0);
-        return;
+        client_send(client, msg, strlen(msg));
+        return NULL;
     }
     
     Game *game = get_game_by_id(client->current_game_id);
     if (!game || game->creator_id != client->id) {
         snprintf(msg, sizeof(msg),
             "\n[ERROR] You are not the creator of this game.\n\n");
-        send(client->socket, msg, strlen(msg), 0);
-        return;
-    }
-    
-    int requester_id = -1;
-    pthread_mutex_lock(&clients_mutex);
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (clients[i].is_connected && strcmp(clients[i].username, username) == 0) {
-            requester_id = clients[i].id;
-            break;
-        }
+        client_send(client, msg, strlen(msg));
+        return NULL;
     }
-    pthread_mutex_unlock(&clients_mutex);
-    
-    if (requester_id < 0) {
-        snprintf(msg, sizeof(msg),
-            "\n[ERROR] Player '%s' not found.\n\n", username);
-        send(client->socket, msg, strlen(msg), 0);
-        return;
-    }
-    
+    return game;
+}
+
+/**
+ * Accept or reject a join request, once its requester is known
+ */
+static void accept_reject(Client *client, Game *game, int requester_id,
+                          const char *username, int accept) {
+    char msg[BUFFER_SIZE];
     int result = process_join_request(client->current_game_id, requester_id, accept);
     
     if (result == 0) {
         if (accept) {
-            snprintf(msg, sizeof(msg),
+            game_turn_start(game);
+            char grid_msg[BUFFER_SIZE];
+            format_grid(game, grid_msg, sizeof(grid_msg));
+            int cols = board_variant(&game->board)->cols;
+            
+            Response r;
+            response_init(&r);
+            RESPONSE_LITERAL(&r,
                 "\n╔═══════════════════════════════════════════════════════════════╗\n"
                 "║                    THE GAME BEGINS!                            ║\n"
                 "╠═══════════════════════════════════════════════════════════════╣\n"
-                "║  You accepted %s into the game.                                \n"
+                "║  You accepted ");
+            response_string(&r, username);
+            RESPONSE_LITERAL(&r,
+                " into the game.                                \n"
                 "║  You play with: X (first turn)                                 ║\n"
-                "║  Use 'move <1-7>' to make your move!                           ║\n"
-                "╚═══════════════════════════════════════════════════════════════╝\n\n",
-                username);
-            send(client->socket, msg, strlen(msg), 0);
-            
-            char grid_msg[BUFFER_SIZE];
-            format_grid(game, grid_msg, sizeof(grid_msg));
-            send(client->socket, grid_msg, strlen(grid_msg), 0);
+                "║  Use 'move <1-");
+            response_static(&r, &column_digits[cols - 1], 1);
+            RESPONSE_LITERAL(&r,
+                ">' to make your move!                           ║\n"
+                "╚═══════════════════════════════════════════════════════════════╝\n\n");
+            response_string(&r, grid_msg);
+            GameEventMsg event;
+            proto_game_event(&event, GAME_EVENT_STARTED, game->id, client->id, requester_id);
+            client_send_event(client, &r, MSG_GAME_EVENT, &event, sizeof(event));
             
-            char opponent_msg[BUFFER_SIZE];
-            snprintf(opponent_msg, sizeof(opponent_msg),
+            response_init(&r);
+            RESPONSE_LITERAL(&r,
                 "\n╔═══════════════════════════════════════════════════════════════╗\n"
                 "║                    THE GAME BEGINS!                            ║\n"
                 "╠═══════════════════════════════════════════════════════════════╣\n"
-                "║  %s accepted your request!                                     \n"
+                "║  ");
+            response_string(&r, client->username);
+            RESPONSE_LITERAL(&r,
+                " accepted your request!                                     \n"
                 "║  You play with: O                                              ║\n"
                 "║  Wait for opponent's turn...                                   ║\n"
-                "╚═══════════════════════════════════════════════════════════════╝\n\n",
-                client->username);
-            send_to_client(requester_id, opponent_msg);
-            send_to_client(requester_id, grid_msg);
+                "╚═══════════════════════════════════════════════════════════════╝\n\n");
+            response_string(&r, grid_msg);
+            send_event_to_client(requester_id, &r, MSG_GAME_EVENT, &event, sizeof(event));
             
             char broadcast_msg[BUFFER_SIZE];
             snprintf(broadcast_msg, sizeof(broadcast_msg),
                 "\n[NOTICE] Game #%d between %s and %s has started!\n\n",
                 client->current_game_id, client->username, username);
-            broadcast_except(client->id, broadcast_msg);
+            broadcast_event_except(client->id, broadcast_msg, MSG_GAME_EVENT, &event, sizeof(event));
         } else {
             snprintf(msg, sizeof(msg),
                 "\n[OK] You rejected %s's request.\n\n", username);
-            send(client->socket, msg, strlen(msg), 0);
+            client_send(client, msg, strlen(msg));
             
             char reject_msg[BUFFER_SIZE];
             snprintf(reject_msg, sizeof(reject_msg),
                 "\n[NOTICE] %s rejected your request for game #%d.\n\n",
                 client->username, client->current_game_id);
-            send_to_client(requester_id, reject_msg);
+            
+            Response r;
+            response_init(&r);
+            response_string(&r, reject_msg);
+            GameEventMsg event;
+            proto_game_event(&event, GAME_EVENT_REJECTED, client->current_game_id, client->id, -1);
+            send_event_to_client(requester_id, &r, MSG_GAME_EVENT, &event, sizeof(event));
         }
     } else {
         snprintf(msg, sizeof(msg),
             "\n[ERROR] Unable to process the request.\n\n");
-        send(client->socket, msg, strlen(msg), 0);
+        client_send(client, msg, strlen(msg));
     }
 }
 
+/**
+ * Accept or reject the request of a player, found by name
+ */
+void handle_accept_reject(Client *client, const char *username, int accept) {
+    Game *game = accept_reject_game(client);
+    if (!game) return;
+    
+    Client *requester = get_client_by_username(username);
+    if (!requester) {
+        char msg[BUFFER_SIZE];
+        snprintf(msg, sizeof(msg),
+            "\n[ERROR] Player '%s' not found.\n\n", username);
+        client_send(client, msg, strlen(msg));
+        return;
+    }
+    accept_reject(client, game, requester->id, username, accept);
+}
+
+/**
+ * Accept or reject the request of a player, found by id (binary
+ * protocol); its name is only needed for the messages
+ */
+void handle_accept_reject_id(Client *client, int requester_id, int accept) {
+    Game *game = accept_reject_game(client);
+    if (!game) return;
+    
+    char username[MAX_USERNAME];
+    Client *requester = lock_client_by_id(requester_id);
+    if (!requester) {
+        char msg[BUFFER_SIZE];
+        snprintf(msg, sizeof(msg),
+            "\n[ERROR] Player #%d not found.\n\n", requester_id);
+        client_send(client, msg, strlen(msg));
+        return;
+    }
+    memcpy(username, requester->username, sizeof(username));
+    unlock_client(requester);
+    
+    accept_reject(client, game, requester_id, username, accept);
+}
+
 void handle_move(Client *client, int column) {
     char msg[BUFFER_SIZE];
     
     if (client->current_game_id < 0) {
         snprintf(msg, sizeof(msg),
             "\n[ERROR] You are not in any game.\n\n");
-        send(client->socket, msg, strlen(msg), 0);
+        client_send(client, msg, strlen(msg));
         return;
     }
     
@@ -374,7 +507,16 @@ void handle_move(Client *client, int column) {
     if (!game) {
         snprintf(msg, sizeof(msg),
             "\n[ERROR] Game not found.\n\n");
-        send(client->socket, msg, strlen(msg), 0);
+        client_send(client, msg, strlen(msg));
+        return;
+    }
+    
+    // The command parsers only know the largest board
+    const Variant *v = board_variant(&game->board);
+    if (column > v->cols) {
+        snprintf(msg, sizeof(msg),
+            "\n[ERROR] Usage: move <1-%d>\n\n", v->cols);
+        client_send(client, msg, strlen(msg));
         return;
     }
     
@@ -383,136 +525,209 @@ void handle_move(Client *client, int column) {
     
     switch (result) {
         case 0: {
+            if (game->state == GAME_IN_PROGRESS) {
+                __atomic_store_n(&game->turn_started, timer_now(), __ATOMIC_RELAXED);
+            } else {
+                timer_cancel(&game->turn_timer);
+            }
+            
             char grid_msg[BUFFER_SIZE];
             format_grid(game, grid_msg, sizeof(grid_msg));
             
             int opponent_id = (client->id == game->creator_id) ? game->opponent_id : game->creator_id;
             
+            MoveMsg move;
+            int row = v->rows - game->board.heights[col];
+            move.game_id = proto_id(game->id);
+            move.player_id = proto_id(client->id);
+            move.column = column;
+            move.row = row;
+            move.piece = board_cell(&game->board, row, col);
+            move.result = game->state != GAME_FINISHED ? MOVE_PLAYING
+                        : game->winner_id == -1 ? MOVE_DRAW : MOVE_WON;
+            move.next_turn = proto_id(game->state == GAME_IN_PROGRESS ? game->current_turn : -1);
+            
+            Response r;
             if (game->state == GAME_FINISHED) {
                 if (game->winner_id == client->id) {
-                    pthread_mutex_lock(&game->game_mutex);
                     int old_creator = game->creator_id;
                     int old_opponent = game->opponent_id;
+                    game_write_begin(game);
                     game->creator_id = game->winner_id;
                     game->opponent_id = (old_creator == game->winner_id) ? old_opponent : old_creator;
-                    pthread_mutex_unlock(&game->game_mutex);
+                    game_write_end(game);
                     
-                    snprintf(msg, sizeof(msg),
-                        "%s\n"
+                    response_init(&r);
+                    response_string(&r, grid_msg);
+                    RESPONSE_LITERAL(&r,
+                        "\n"
                         "╔═══════════════════════════════════════════════════════════════╗\n"
                         "║                      YOU WON! 🎉                               ║\n"
                         "╠═══════════════════════════════════════════════════════════════╣\n"
-                        "║  Congratulations! You connected 4 pieces!                      ║\n"
+                        "║  Congratulations! You connected ");
+                    response_static(&r, &column_digits[v->connect - 1], 1);
+                    RESPONSE_LITERAL(&r,
+                        " pieces!                      ║\n"
                         "║  You are now the game creator.                                  ║\n"
                         "║  Use 'rematch' to propose a rematch to your opponent.           ║\n"
-                        "╚═══════════════════════════════════════════════════════════════╝\n\n",
-                        grid_msg);
-                    send(client->socket, msg, strlen(msg), 0);
+                        "╚═══════════════════════════════════════════════════════════════╝\n\n");
+                    client_send_event(client, &r, MSG_MOVE, &move, sizeof(move));
                     
-                    snprintf(msg, sizeof(msg),
-                        "%s\n"
+                    response_init(&r);
+                    response_string(&r, grid_msg);
+                    RESPONSE_LITERAL(&r,
+                        "\n"
                         "╔═══════════════════════════════════════════════════════════════╗\n"
                         "║                      YOU LOST! 😢                              ║\n"
                         "╠═══════════════════════════════════════════════════════════════╣\n"
-                        "║  %s connected 4 pieces.                                        \n"
+                        "║  ");
+                    response_string(&r, client->username);
+                    RESPONSE_LITERAL(&r, " connected ");
+                    response_static(&r, &column_digits[v->connect - 1], 1);
+                    RESPONSE_LITERAL(&r,
+                        " pieces.                                        \n"
                         "║  You must leave the game.                                       ║\n"
                         "║  You can only stay if the winner proposes a rematch.            ║\n"
                         "║  Use 'leave' to exit the game.                                  ║\n"
-                        "╚═══════════════════════════════════════════════════════════════╝\n\n",
-                        grid_msg, client->username);
-                    send_to_client(opponent_id, msg);
+                        "╚═══════════════════════════════════════════════════════════════╝\n\n");
+                    send_event_to_client(opponent_id, &r, MSG_MOVE, &move, sizeof(move));
                 } else if (game->winner_id == -1) {
-                    snprintf(msg, sizeof(msg),
-                        "%s\n"
+                    response_init(&r);
+                    response_string(&r, grid_msg);
+                    RESPONSE_LITERAL(&r,
+                        "\n"
                         "╔═══════════════════════════════════════════════════════════════╗\n"
                         "║                        DRAW! 🤝                                ║\n"
                         "╠═══════════════════════════════════════════════════════════════╣\n"
                         "║  The grid is full! No winner.                                  ║\n"
                         "║  Use 'rematch' to propose/accept a rematch.                    ║\n"
-                        "╚═══════════════════════════════════════════════════════════════╝\n\n",
-                        grid_msg);
-                    send(client->socket, msg, strlen(msg), 0);
-                    send_to_client(opponent_id, msg);
+                        "╚═══════════════════════════════════════════════════════════════╝\n\n");
+                    client_send_event(client, &r, MSG_MOVE, &move, sizeof(move));
+                    send_event_to_client(opponent_id, &r, MSG_MOVE, &move, sizeof(move));
                 }
                 
                 const char *opponent_name = get_username(opponent_id);
                 char broadcast_msg[BUFFER_SIZE];
+                GameEventMsg event;
                 if (game->winner_id == -1) {
                     snprintf(broadcast_msg, sizeof(broadcast_msg),
                         "\n[NOTICE] Game #%d between %s and %s ended in a draw!\n\n",
                         game->id, client->username, opponent_name);
+                    proto_game_event(&event, GAME_EVENT_DRAW, game->id, client->id, opponent_id);
                 } else {
                     snprintf(broadcast_msg, sizeof(broadcast_msg),
                         "\n[NOTICE] Game #%d is over! Winner: %s\n\n",
                         game->id, get_username(game->winner_id));
+                    proto_game_event(&event, GAME_EVENT_OVER, game->id, game->winner_id, opponent_id);
                 }
-                broadcast_except(client->id, broadcast_msg);
+                broadcast_event_except(client->id, broadcast_msg, MSG_GAME_EVENT, &event, sizeof(event));
             } else {
-                snprintf(msg, sizeof(msg),
-                    "%s\n[OK] Move made in column %d. Wait for opponent's turn...\n\n",
-                    grid_msg, column);
-                send(client->socket, msg, strlen(msg), 0);
+                response_init(&r);
+                r.kind = OUT_BOARD;
+                response_string(&r, grid_msg);
+                RESPONSE_LITERAL(&r, "\n[OK] Move made in column ");
+                response_static(&r, &column_digits[col], 1);
+                RESPONSE_LITERAL(&r, ". Wait for opponent's turn...\n\n");
+                client_send_event(client, &r, MSG_MOVE, &move, sizeof(move));
                 
-                snprintf(msg, sizeof(msg),
-                    "%s\n[TURN] %s played in column %d. It's your turn!\n"
-                    "       Use 'move <1-7>' to make your move.\n\n",
-                    grid_msg, client->username, column);
-                send_to_client(opponent_id, msg);
+                response_init(&r);
+                r.kind = OUT_BOARD;
+                response_string(&r, grid_msg);
+                RESPONSE_LITERAL(&r, "\n[TURN] ");
+                response_string(&r, client->username);
+                RESPONSE_LITERAL(&r, " played in column ");
+                response_static(&r, &column_digits[col], 1);
+                RESPONSE_LITERAL(&r, ". It's your turn!\n"
+                    "       Use 'move <1-");
+                response_static(&r, &column_digits[v->cols - 1], 1);
+                RESPONSE_LITERAL(&r, ">' to make your move.\n\n");
+                send_event_to_client(opponent_id, &r, MSG_MOVE, &move, sizeof(move));
             }
+            bot_turn(game);
             break;
         }
         case -2:
             snprintf(msg, sizeof(msg),
                 "\n[ERROR] The game is not in progress.\n\n");
-            send(client->socket, msg, strlen(msg), 0);
+            client_send(client, msg, strlen(msg));
             break;
         case -3:
             snprintf(msg, sizeof(msg),
                 "\n[ERROR] It's not your turn!\n\n");
-            send(client->socket, msg, strlen(msg), 0);
+            client_send(client, msg, strlen(msg));
             break;
         case -4:
             snprintf(msg, sizeof(msg),
-                "\n[ERROR] Column full or invalid. Choose a column from 1 to 7.\n\n");
-            send(client->socket, msg, strlen(msg), 0);
+                "\n[ERROR] Column full or invalid. Choose a column from 1 to %d.\n\n", v->cols);
+            client_send(client, msg, strlen(msg));
             break;
         default:
             snprintf(msg, sizeof(msg),
                 "\n[ERROR] Error during move.\n\n");
-            send(client->socket, msg, strlen(msg), 0);
+            client_send(client, msg, strlen(msg));
     }
 }
 
+void handle_stats(Client *client) {
+    char msg[BUFFER_SIZE];
+    // Per mille
+    int usage = bot_table_usage();
+    unsigned long probes = __atomic_load_n(&bot_table_stats.probes, __ATOMIC_RELAXED);
+    unsigned long hits = __atomic_load_n(&bot_table_stats.hits, __ATOMIC_RELAXED);
+    int hit_rate = probes ? (int)(hits * 1000 / probes) : 0;
+    
+    snprintf(msg, sizeof(msg),
+        "\n[STATS] Slow consumers: %lu, notices dropped: %lu, "
+        "boards coalesced: %lu, evictions: %lu\n"
+        "[STATS] Bot table: %lu entries, %d.%d%% used, probes: %lu, hits: %lu (%d.%d%%), cutoffs: %lu\n\n",
+        __atomic_load_n(&outq_stats.congested, __ATOMIC_RELAXED),
+        __atomic_load_n(&outq_stats.notices_dropped, __ATOMIC_RELAXED),
+        __atomic_load_n(&outq_stats.boards_coalesced, __ATOMIC_RELAXED),
+        __atomic_load_n(&outq_stats.evictions, __ATOMIC_RELAXED),
+        bot_table_entries(), usage / 10, usage % 10, probes, hits,
+        hit_rate / 10, hit_rate % 10, __atomic_load_n(&bot_table_stats.cutoffs, __ATOMIC_RELAXED));
+    client_send(client, msg, strlen(msg));
+}
+
 void handle_grid(Client *client) {
     char msg[BUFFER_SIZE];
     
     if (client->current_game_id < 0) {
         snprintf(msg, sizeof(msg),
             "\n[ERROR] You are not in any game.\n\n");
-        send(client->socket, msg, strlen(msg), 0);
+        client_send(client, msg, strlen(msg));
         return;
     }
     
-    Game *game = get_game_by_id(client->current_game_id);
-    if (!game) {
+    // Copied from the game, not read on its strand
+    Game snap;
+    Game *game = &snap;
+    if (game_snapshot(client->current_game_id, game) < 0) {
         snprintf(msg, sizeof(msg),
             "\n[ERROR] Game not found.\n\n");
-        send(client->socket, msg, strlen(msg), 0);
+        client_send(client, msg, strlen(msg));
         return;
     }
     
     char grid_msg[BUFFER_SIZE];
     format_grid(game, grid_msg, sizeof(grid_msg));
-    send(client->socket, grid_msg, strlen(grid_msg), 0);
     
+    Response r;
+    response_init(&r);
+    r.kind = OUT_BOARD;
+    response_string(&r, grid_msg);
     if (game->state == GAME_IN_PROGRESS) {
         if (game->current_turn == client->id) {
-            snprintf(msg, sizeof(msg), "[INFO] It's your turn! Use 'move <1-7>'.\n\n");
+            RESPONSE_LITERAL(&r, "[INFO] It's your turn! Use 'move <1-");
+            response_static(&r, &column_digits[board_variant(&game->board)->cols - 1], 1);
+            RESPONSE_LITERAL(&r, ">'.\n\n");
         } else {
-            snprintf(msg, sizeof(msg), "[INFO] Wait for opponent's turn...\n\n");
+            RESPONSE_LITERAL(&r, "[INFO] Wait for opponent's turn...\n\n");
         }
-        send(client->socket, msg, strlen(msg), 0);
     }
+    BoardMsg board;
+    size_t board_len = proto_board(game, &board);
+    client_send_event(client, &r, MSG_BOARD, &board, board_len);
 }
 
 void handle_leave(Client *client) {
@@ -521,7 +736,7 @@ void handle_leave(Client *client) {
     if (client->current_game_id < 0) {
         snprintf(msg, sizeof(msg),
             "\n[ERROR] You are not in any game.\n\n");
-        send(client->socket, msg, strlen(msg), 0);
+        client_send(client, msg, strlen(msg));
         return;
     }
     
@@ -530,25 +745,23 @@ void handle_leave(Client *client) {
         client->current_game_id = -1;
         snprintf(msg, sizeof(msg),
             "\n[OK] You left the game.\n\n");
-        send(client->socket, msg, strlen(msg), 0);
+        client_send(client, msg, strlen(msg));
         return;
     }
     
     int game_id = client->current_game_id;
     int opponent_id = -1;
-    pthread_mutex_lock(&game->game_mutex);
-    
     if (game->state == GAME_IN_PROGRESS) {
         opponent_id = (client->id == game->creator_id) ? game->opponent_id : game->creator_id;
+        game_write_begin(game);
         game->winner_id = opponent_id;
         game->state = GAME_FINISHED;
+        game_write_end(game);
     }
-    
-    pthread_mutex_unlock(&game->game_mutex);
     client->current_game_id = -1;
     snprintf(msg, sizeof(msg),
         "\n[OK] You left game #%d.\n\n", game_id);
-    send(client->socket, msg, strlen(msg), 0);
+    client_send(client, msg, strlen(msg));
     
     if (opponent_id >= 0) {
         snprintf(msg, sizeof(msg),
@@ -559,12 +772,17 @@ void handle_leave(Client *client) {
             "║  Victory by forfeit.                                           ║\n"
             "╚═══════════════════════════════════════════════════════════════╝\n\n",
             client->username);
-        send_to_client(opponent_id, msg);
+        Response r;
+        response_init(&r);
+        response_string(&r, msg);
+        GameEventMsg event;
+        proto_game_event(&event, GAME_EVENT_LEFT, game_id, client->id, opponent_id);
+        send_event_to_client(opponent_id, &r, MSG_GAME_EVENT, &event, sizeof(event));
         char broadcast_msg[BUFFER_SIZE];
         snprintf(broadcast_msg, sizeof(broadcast_msg),
             "\n[NOTICE] Game #%d is over. %s left.\n\n",
             game_id, client->username);
-        broadcast_except(client->id, broadcast_msg);
+        broadcast_event_except(client->id, broadcast_msg, MSG_GAME_EVENT, &event, sizeof(event));
     }
     
     if (game->state == GAME_FINISHED || game->state == GAME_WAITING) {
@@ -578,7 +796,7 @@ void handle_rematch(Client *client) {
     if (client->current_game_id < 0) {
         snprintf(msg, sizeof(msg),
             "\n[ERROR] You are not in any game.\n\n");
-        send(client->socket, msg, strlen(msg), 0);
+        client_send(client, msg, strlen(msg));
         return;
     }
     
@@ -586,7 +804,7 @@ void handle_rematch(Client *client) {
     if (!game || game->state != GAME_FINISHED) {
         snprintf(msg, sizeof(msg),
             "\n[ERROR] The game must be finished to request a rematch.\n\n");
-        send(client->socket, msg, strlen(msg), 0);
+        client_send(client, msg, strlen(msg));
         return;
     }
     
@@ -595,60 +813,160 @@ void handle_rematch(Client *client) {
             snprintf(msg, sizeof(msg),
                 "\n[ERROR] Only the winner can propose a rematch.\n"
                 "           You must leave the game. Use 'leave' to exit.\n\n");
-            send(client->socket, msg, strlen(msg), 0);
+            client_send(client, msg, strlen(msg));
             return;
         }
     }
     
     int opponent_id = (client->id == game->creator_id) ? game->opponent_id : game->creator_id;
     reset_game_for_rematch(client->current_game_id);
+    game_turn_start(game);
     const char *first_player = get_username(game->current_turn);
     char your_symbol = (client->id == game->creator_id) ? PLAYER1 : PLAYER2;
     char opp_symbol = (client->id == game->creator_id) ? PLAYER2 : PLAYER1;
     
-    snprintf(msg, sizeof(msg),
+    char grid_msg[BUFFER_SIZE];
+    format_grid(game, grid_msg, sizeof(grid_msg));
+    
+    GameEventMsg event;
+    proto_game_event(&event, GAME_EVENT_REMATCH, game->id, game->current_turn,
+                     game->current_turn == client->id ? opponent_id : client->id);
+    
+    Response r;
+    response_init(&r);
+    RESPONSE_LITERAL(&r,
         "\n╔═══════════════════════════════════════════════════════════════╗\n"
         "║                    REMATCH STARTED!                            ║\n"
         "╠═══════════════════════════════════════════════════════════════╣\n"
         "║  The grid has been reset.                                      ║\n"
-        "║  You play with: %c                                              ║\n"
-        "║  First turn: %s                                                \n"
-        "╚═══════════════════════════════════════════════════════════════╝\n\n",
-        your_symbol, first_player);
-    send(client->socket, msg, strlen(msg), 0);
-    
-    char grid_msg[BUFFER_SIZE];
-    format_grid(game, grid_msg, sizeof(grid_msg));
-    send(client->socket, grid_msg, strlen(grid_msg), 0);
+        "║  You play with: ");
+    response_static(&r, symbol_text(your_symbol), 1);
+    RESPONSE_LITERAL(&r,
+        "                                              ║\n"
+        "║  First turn: ");
+    response_string(&r, first_player);
+    RESPONSE_LITERAL(&r,
+        "                                                \n"
+        "╚═══════════════════════════════════════════════════════════════╝\n\n");
+    response_string(&r, grid_msg);
+    client_send_event(client, &r, MSG_GAME_EVENT, &event, sizeof(event));
     
-    snprintf(msg, sizeof(msg),
+    response_init(&r);
+    RESPONSE_LITERAL(&r,
         "\n╔═══════════════════════════════════════════════════════════════╗\n"
         "║                    REMATCH STARTED!                            ║\n"
         "╠═══════════════════════════════════════════════════════════════╣\n"
-        "║  %s accepted the rematch!                                      \n"
-        "║  You play with: %c                                              ║\n"
-        "║  First turn: %s                                                \n"
-        "╚═══════════════════════════════════════════════════════════════╝\n\n",
-        client->username, opp_symbol, first_player);
-    send_to_client(opponent_id, msg);
-    send_to_client(opponent_id, grid_msg);
+        "║  ");
+    response_string(&r, client->username);
+    RESPONSE_LITERAL(&r,
+        " accepted the rematch!                                      \n"
+        "║  You play with: ");
+    response_static(&r, symbol_text(opp_symbol), 1);
+    RESPONSE_LITERAL(&r,
+        "                                              ║\n"
+        "║  First turn: ");
+    response_string(&r, first_player);
+    RESPONSE_LITERAL(&r,
+        "                                                \n"
+        "╚═══════════════════════════════════════════════════════════════╝\n\n");
+    response_string(&r, grid_msg);
+    send_event_to_client(opponent_id, &r, MSG_GAME_EVENT, &event, sizeof(event));
     
     char broadcast_msg[BUFFER_SIZE];
     snprintf(broadcast_msg, sizeof(broadcast_msg),
         "\n[NOTICE] Rematch started in game #%d!\n\n",
         client->current_game_id);
-    broadcast_except(client->id, broadcast_msg);
+    broadcast_event_except(client->id, broadcast_msg, MSG_GAME_EVENT, &event, sizeof(event));
+    bot_turn(game);
+}
+
+/**
+ * Play the column the bot chose, on the game's strand, and show it to
+ * its opponent
+ */
+void handle_bot_move(Game *game, int col) {
+    if (make_move(game->id, BOT_ID, col) != 0) return;
+    
+    if (game->state == GAME_IN_PROGRESS) {
+        __atomic_store_n(&game->turn_started, timer_now(), __ATOMIC_RELAXED);
+    } else {
+        timer_cancel(&game->turn_timer);
+    }
+    
+    const Variant *v = board_variant(&game->board);
+    int player_id = (game->creator_id == BOT_ID) ? game->opponent_id : game->creator_id;
+    char grid_msg[BUFFER_SIZE];
+    format_grid(game, grid_msg, sizeof(grid_msg));
+    
+    MoveMsg move;
+    int row = v->rows - game->board.heights[col];
+    move.game_id = proto_id(game->id);
+    move.player_id = proto_id(BOT_ID);
+    move.column = col + 1;
+    move.row = row;
+    move.piece = board_cell(&game->board, row, col);
+    move.result = game->state != GAME_FINISHED ? MOVE_PLAYING
+                : game->winner_id == -1 ? MOVE_DRAW : MOVE_WON;
+    move.next_turn = proto_id(game->state == GAME_IN_PROGRESS ? game->current_turn : -1);
+    
+    Response r;
+    response_init(&r);
+    response_string(&r, grid_msg);
+    if (game->state == GAME_IN_PROGRESS) {
+        r.kind = OUT_BOARD;
+        RESPONSE_LITERAL(&r, "\n[TURN] " BOT_NAME " played in column ");
+        response_static(&r, &column_digits[col], 1);
+        RESPONSE_LITERAL(&r, ". It's your turn!\n"
+            "       Use 'move <1-");
+        response_static(&r, &column_digits[v->cols - 1], 1);
+        RESPONSE_LITERAL(&r, ">' to make your move.\n\n");
+        send_event_to_client(player_id, &r, MSG_MOVE, &move, sizeof(move));
+        return;
+    }
+    
+    char broadcast_msg[BUFFER_SIZE];
+    GameEventMsg event;
+    if (game->winner_id == BOT_ID) {
+        RESPONSE_LITERAL(&r,
+            "\n"
+            "╔═══════════════════════════════════════════════════════════════╗\n"
+            "║                      YOU LOST! 😢                              ║\n"
+            "╠═══════════════════════════════════════════════════════════════╣\n"
+            "║  " BOT_NAME " connected ");
+        response_static(&r, &column_digits[v->connect - 1], 1);
+        RESPONSE_LITERAL(&r,
+            " pieces.                                        \n"
+            "║  Use 'rematch' to play again, or 'leave' to exit.              ║\n"
+            "╚═══════════════════════════════════════════════════════════════╝\n\n");
+        snprintf(broadcast_msg, sizeof(broadcast_msg),
+            "\n[NOTICE] Game #%d is over! Winner: " BOT_NAME "\n\n", game->id);
+        proto_game_event(&event, GAME_EVENT_OVER, game->id, BOT_ID, player_id);
+    } else {
+        RESPONSE_LITERAL(&r,
+            "\n"
+            "╔═══════════════════════════════════════════════════════════════╗\n"
+            "║                        DRAW! 🤝                                ║\n"
+            "╠═══════════════════════════════════════════════════════════════╣\n"
+            "║  The grid is full! No winner.                                  ║\n"
+            "║  Use 'rematch' to propose/accept a rematch.                    ║\n"
+            "╚═══════════════════════════════════════════════════════════════╝\n\n");
+        snprintf(broadcast_msg, sizeof(broadcast_msg),
+            "\n[NOTICE] Game #%d between " BOT_NAME " and %s ended in a draw!\n\n",
+            game->id, get_username(player_id));
+        proto_game_event(&event, GAME_EVENT_DRAW, game->id, BOT_ID, player_id);
+    }
+    send_event_to_client(player_id, &r, MSG_MOVE, &move, sizeof(move));
+    broadcast_event_except(player_id, broadcast_msg, MSG_GAME_EVENT, &event, sizeof(event));
 }
 
 // ===========================
 // CLIENT HANDLER
 // ===========================
 
-void *handle_client(void *arg) {
-    Client *client = (Client *)arg;
-    char buffer[BUFFER_SIZE];
-    int bytes_read;
-    
+/**
+ * Greet a freshly accepted client and ask for its username
+ */
+void client_welcome(Client *client) {
     printf("[SERVER] Client #%d connected from %s:%d\n",
            client->id,
            inet_ntoa(client->address.sin_addr),
@@ -661,22 +979,31 @@ void *handle_client(void *arg) {
         "║  Enter your username:                                         ║\n"
         "╚═══════════════════════════════════════════════════════════════╝\n\n"
         "Username: ";
-    send(client->socket, welcome, strlen(welcome), 0);
-    
-    bytes_read = recv(client->socket, buffer, MAX_USERNAME - 1, 0);
-    if (bytes_read <= 0) {
-        printf("[SERVER] Client #%d disconnected during login\n", client->id);
-        goto cleanup;
+    client_send(client, welcome, strlen(welcome));
+}
+
+/**
+ * Register the username sent during login, or ask for another one
+ * if a connected client already has it
+ * A PROTO_BINARY_LOGIN prefix switches the client to the binary protocol
+ */
+static void client_login(Client *client, const char *name) {
+    size_t prefix = strlen(PROTO_BINARY_LOGIN);
+    int binary = strncmp(name, PROTO_BINARY_LOGIN, prefix) == 0 && name[prefix] != '\0';
+    if (binary) {
+        name += prefix;
+    }
+    if (client_register_name(client, name) < 0) {
+        char taken_msg[BUFFER_SIZE];
+        snprintf(taken_msg, sizeof(taken_msg),
+            "\n[ERROR] Username '%.*s' is already taken. Choose another one.\n\nUsername: ",
+            MAX_USERNAME - 1, name);
+        client_send(client, taken_msg, strlen(taken_msg));
+        return;
+    }
+    if (binary) {
+        client->proto = PROTO_BINARY;
     }
-    
-    buffer[bytes_read] = '\0';
-    char *newline = strchr(buffer, '\n');
-    if (newline) *newline = '\0';
-    newline = strchr(buffer, '\r');
-    if (newline) *newline = '\0';
-    
-    strncpy(client->username, buffer, MAX_USERNAME - 1);
-    client->username[MAX_USERNAME - 1] = '\0';
     
     printf("[SERVER] Client #%d registered as '%s'\n", client->id, client->username);
     
@@ -684,117 +1011,551 @@ void *handle_client(void *arg) {
     snprintf(confirm_msg, sizeof(confirm_msg),
         "\n[OK] Welcome %s! Type 'help' to see available commands.\n\n",
         client->username);
-    send(client->socket, confirm_msg, strlen(confirm_msg), 0);
+    Response r;
+    response_init(&r);
+    response_string(&r, confirm_msg);
+    LoginMsg login = { .client_id = proto_id(client->id) };
+    client_send_event(client, &r, MSG_LOGIN, &login, sizeof(login));
     
     char join_msg[BUFFER_SIZE];
     snprintf(join_msg, sizeof(join_msg),
         "\n[NOTICE] %s connected to the server.\n\n", client->username);
-    broadcast_except(client->id, join_msg);
+    ClientEventMsg event;
+    proto_client_event(&event, CLIENT_EVENT_CONNECTED, client);
+    broadcast_event_except(client->id, join_msg, MSG_CLIENT_EVENT, &event, sizeof(event));
+}
+
+/**
+ * Parse and run a single command line
+ * Returns -1 when the client asked to quit
+ */
+int handle_command(Client *client, char *buffer) {
+    printf("[SERVER] %s: %s\n", client->username, buffer);
+    char cmd[64];
+    char arg[64];
+    int num_arg;
     
-    while (server_running && (bytes_read = recv(client->socket, buffer, BUFFER_SIZE - 1, 0)) > 0) {
-        buffer[bytes_read] = '\0';
-        
-        newline = strchr(buffer, '\n');
-        if (newline) *newline = '\0';
-        newline = strchr(buffer, '\r');
-        if (newline) *newline = '\0';
-        if (strlen(buffer) == 0) continue;
-        
-        printf("[SERVER] %s: %s\n", client->username, buffer);
-        char cmd[64];
-        char arg[64];
-        int num_arg;
-        
-        if (sscanf(buffer, "%63s %63s", cmd, arg) < 1) continue;
-        
-        for (int i = 0; cmd[i]; i++) {
-            if (cmd[i] >= 'A' && cmd[i] <= 'Z') {
-                cmd[i] = cmd[i] + 32;
-            }
-        }
-        
-        if (strcmp(cmd, "help") == 0) {
-            handle_help(client);
-        }
-        else if (strcmp(cmd, "list") == 0) {
-            handle_list(client);
-        }
-        else if (strcmp(cmd, "status") == 0) {
-            handle_status(client);
+    int args = sscanf(buffer, "%63s %63s", cmd, arg);
+    if (args < 1) return 0;
+    
+    for (int i = 0; cmd[i]; i++) {
+        if (cmd[i] >= 'A' && cmd[i] <= 'Z') {
+            cmd[i] = cmd[i] + 32;
         }
-        else if (strcmp(cmd, "create") == 0) {
-            handle_create(client);
+    }
+    
+    if (strcmp(cmd, "help") == 0) {
+        handle_help(client);
+    }
+    else if (strcmp(cmd, "list") == 0) {
+        handle_list(client);
+    }
+    else if (strcmp(cmd, "status") == 0) {
+        handle_status(client);
+    }
+    else if (strcmp(cmd, "stats") == 0) {
+        handle_stats(client);
+    }
+    else if (strcmp(cmd, "play") == 0) {
+        char board[64];
+        int n = sscanf(buffer, "%*s %63s %d %63s", arg, &num_arg, board);
+        if (n >= 2 && strcasecmp(arg, "bot") == 0) {
+            handle_play_bot(client, num_arg, n == 3 ? variant_find(board) : 0);
+        } else {
+            client_send(client, "\n[ERROR] Usage: play bot <level> [board]\n\n", 42);
         }
-        else if (strcmp(cmd, "join") == 0) {
-            if (sscanf(buffer, "%*s %d", &num_arg) == 1) {
-                handle_join(client, num_arg);
-            } else {
-                send(client->socket, "\n[ERROR] Usage: join <game_id>\n\n", 33, 0);
-            }
+    }
+    else if (strcmp(cmd, "create") == 0) {
+        handle_create(client, args == 2 ? variant_find(arg) : 0);
+    }
+    else if (strcmp(cmd, "join") == 0) {
+        if (sscanf(buffer, "%*s %d", &num_arg) == 1) {
+            handle_join(client, num_arg);
+        } else {
+            client_send(client, "\n[ERROR] Usage: join <game_id>\n\n", 33);
         }
-        else if (strcmp(cmd, "requests") == 0) {
-            handle_requests(client);
+    }
+    else if (strcmp(cmd, "requests") == 0) {
+        handle_requests(client);
+    }
+    else if (strcmp(cmd, "accept") == 0) {
+        if (strlen(arg) > 0 && strcmp(arg, cmd) != 0) {
+            handle_accept_reject(client, arg, 1);
+        } else {
+            client_send(client, "\n[ERROR] Usage: accept <username>\n\n", 36);
         }
-        else if (strcmp(cmd, "accept") == 0) {
-            if (strlen(arg) > 0 && strcmp(arg, cmd) != 0) {
-                handle_accept_reject(client, arg, 1);
-            } else {
-                send(client->socket, "\n[ERROR] Usage: accept <username>\n\n", 36, 0);
-            }
+    }
+    else if (strcmp(cmd, "reject") == 0) {
+        if (strlen(arg) > 0 && strcmp(arg, cmd) != 0) {
+            handle_accept_reject(client, arg, 0);
+        } else {
+            client_send(client, "\n[ERROR] Usage: reject <username>\n\n", 36);
         }
-        else if (strcmp(cmd, "reject") == 0) {
-            if (strlen(arg) > 0 && strcmp(arg, cmd) != 0) {
-                handle_accept_reject(client, arg, 0);
-            } else {
-                send(client->socket, "\n[ERROR] Usage: reject <username>\n\n", 36, 0);
-            }
+    }
+    else if (strcmp(cmd, "move") == 0) {
+        if (sscanf(buffer, "%*s %d", &num_arg) == 1 && num_arg >= 1 && num_arg <= GRID_MAX_COLS) {
+            handle_move(client, num_arg);
+        } else {
+            client_send(client, "\n[ERROR] Usage: move <column>\n\n", 32);
         }
-        else if (strcmp(cmd, "move") == 0) {
-            if (sscanf(buffer, "%*s %d", &num_arg) == 1 && num_arg >= 1 && num_arg <= 7) {
-                handle_move(client, num_arg);
+    }
+    else if (strcmp(cmd, "grid") == 0) {
+        handle_grid(client);
+    }
+    else if (strcmp(cmd, "leave") == 0) {
+        handle_leave(client);
+    }
+    else if (strcmp(cmd, "rematch") == 0) {
+        handle_rematch(client);
+    }
+    else if (strcmp(cmd, "quit") == 0 || strcmp(cmd, "exit") == 0) {
+        client_send(client, "\n[OK] Goodbye!\n\n", 17);
+        return -1;
+    }
+    else {
+        char err_msg[BUFFER_SIZE];
+        snprintf(err_msg, sizeof(err_msg),
+            "\n[ERROR] Unknown command: %s. Type 'help' for help.\n\n", cmd);
+        client_send(client, err_msg, strlen(err_msg));
+    }
+    return 0;
+}
+
+// ===========================
+// TIMEOUTS
+// ===========================
+
+/**
+ * Login and idle timeout of a client
+ * Commands only record their tick: the timer is re-armed here for the
+ * time left, so that nothing touches the wheel on the command path
+ */
+void client_timeout(Timer *timer) {
+    Client *client = (Client *)((char *)timer - offsetof(Client, timer));
+    if (!client->is_connected || client->id != timer->tag) return;
+    
+    if (client->username[0] == '\0') {
+        printf("[SERVER] Client #%d login timeout\n", client->id);
+        client_expire(client, "\n[ERROR] Login timeout.\n\n");
+        return;
+    }
+    
+    // A game in progress has its own turn timeout
+    Game game;
+    int playing = game_snapshot(client->current_game_id, &game) == 0 && game.state == GAME_IN_PROGRESS;
+    unsigned long idle = timer_now() - __atomic_load_n(&client->last_active, __ATOMIC_RELAXED);
+    if (playing || idle < TIMER_TICKS(IDLE_TIMEOUT_MS)) {
+        unsigned long left = TIMER_TICKS(IDLE_TIMEOUT_MS) - (idle < TIMER_TICKS(IDLE_TIMEOUT_MS) ? idle : 0);
+        timer_arm(timer, left, timer->tag);
+        return;
+    }
+    printf("[SERVER] Client '%s' (#%d) idle timeout\n", client->username, client->id);
+    client_expire(client, "\n[ERROR] Disconnected for inactivity.\n\n");
+}
+
+// Expiry of a turn timer, checked on the strand of its game
+typedef struct TurnTimeoutTask {
+    StrandTask task;
+    int tag;
+} TurnTimeoutTask;
+
+/**
+ * Abandoned game timeout: the player who does not move in time is
+ * disconnected, and forfeits the game as if it had left
+ */
+static void game_turn_check(StrandTask *task) {
+    int tag = ((TurnTimeoutTask *)task)->tag;
+    free(task);
+    Game *game = (Game *)((char *)strand_current() - offsetof(Game, strand));
+    if (!game->is_active || game->id != tag || game->state != GAME_IN_PROGRESS) return;
+    
+    unsigned long waited = timer_now() - __atomic_load_n(&game->turn_started, __ATOMIC_RELAXED);
+    if (waited < TIMER_TICKS(TURN_TIMEOUT_MS)) {
+        timer_arm(&game->turn_timer, TIMER_TICKS(TURN_TIMEOUT_MS) - waited, tag);
+        return;
+    }
+    
+    Client *player = lock_client_by_id(game->current_turn);
+    if (player) {
+        printf("[SERVER] Game #%d abandoned by '%s'\n", game->id, player->username);
+        client_expire(player, "\n[ERROR] You did not move in time: game abandoned.\n\n");
+        unlock_client(player);
+    }
+}
+
+void game_turn_timeout(Timer *timer) {
+    Game *game = (Game *)((char *)timer - offsetof(Game, turn_timer));
+    TurnTimeoutTask *check = malloc(sizeof(TurnTimeoutTask));
+    if (!check) {
+        timer_arm(timer, 1, timer->tag);
+        return;
+    }
+    check->task.run = game_turn_check;
+    check->tag = timer->tag;
+    strand_post(&game->strand, &check->task);
+}
+
+/**
+ * Run a single binary protocol command frame
+ * Returns -1 when the client asked to quit
+ */
+int handle_frame(Client *client, const unsigned char *frame, int len) {
+    FrameHeader hdr;
+    CommandMsg cmd;
+    if (len != sizeof(hdr) + sizeof(cmd)) {
+        client_send(client, "\n[ERROR] Malformed command frame.\n\n", 35);
+        return 0;
+    }
+    memcpy(&hdr, frame, sizeof(hdr));
+    memcpy(&cmd, frame + sizeof(hdr), sizeof(cmd));
+    int arg = proto_arg(&cmd);
+    
+    switch (hdr.type) {
+        case CMD_LIST:      handle_list(client); break;
+        case CMD_STATUS:    handle_status(client); break;
+        case CMD_CREATE:    handle_create(client, arg); break;
+        case CMD_JOIN:      handle_join(client, arg); break;
+        case CMD_REQUESTS:  handle_requests(client); break;
+        case CMD_ACCEPT:
+        case CMD_REJECT:    handle_accept_reject_id(client, arg, hdr.type == CMD_ACCEPT); break;
+        case CMD_MOVE:
+            if (arg >= 1 && arg <= GRID_MAX_COLS) {
+                handle_move(client, arg);
             } else {
-                send(client->socket, "\n[ERROR] Usage: move <1-7>\n\n", 29, 0);
+                client_send(client, "\n[ERROR] Usage: move <column>\n\n", 31);
             }
-        }
-        else if (strcmp(cmd, "grid") == 0) {
-            handle_grid(client);
-        }
-        else if (strcmp(cmd, "leave") == 0) {
-            handle_leave(client);
-        }
-        else if (strcmp(cmd, "rematch") == 0) {
-            handle_rematch(client);
-        }
-        else if (strcmp(cmd, "quit") == 0 || strcmp(cmd, "exit") == 0) {
-            send(client->socket, "\n[OK] Goodbye!\n\n", 17, 0);
             break;
-        }
-        else {
-            char err_msg[BUFFER_SIZE];
-            snprintf(err_msg, sizeof(err_msg),
-                "\n[ERROR] Unknown command: %s. Type 'help' for help.\n\n", cmd);
-            send(client->socket, err_msg, strlen(err_msg), 0);
+        case CMD_GRID:      handle_grid(client); break;
+        case CMD_LEAVE:     handle_leave(client); break;
+        case CMD_REMATCH:   handle_rematch(client); break;
+        case CMD_QUIT:
+            client_send(client, "\n[OK] Goodbye!\n\n", 16);
+            return -1;
+        case CMD_STATS:     handle_stats(client); break;
+        case CMD_PLAY_BOT:  handle_play_bot(client, arg & 0xFF, arg >> 8); break;
+        default:
+            client_send(client, "\n[ERROR] Unknown command frame.\n\n", 33);
+    }
+    return 0;
+}
+
+// ===========================
+// CLIENT COMMAND QUEUE
+// ===========================
+//
+// Game commands run on the strand of their game, everything else on the
+// thread that received it. While one of its commands is queued on a strand,
+// a client's next ones queue behind it, so that they still run (and reply)
+// in the order they were sent; whoever runs the command at the head of the
+// queue runs or posts the next one
+
+enum { TASK_LINE, TASK_FRAME, TASK_DISCONNECT };
+
+#define GAME_NEW (-2)                  // command_game(): the command opens a game
+
+typedef struct ClientTask {
+    StrandTask task;
+    Client *client;
+    int type;
+    int game_id;                       // slot taken for a GAME_NEW command, -1 before
+    int len;
+    char data[];
+} ClientTask;
+
+static void client_task_run(StrandTask *task);
+
+/**
+ * Game whose strand must run a command: the target of a join, the
+ * client's own game for the other game commands, GAME_NEW for the ones
+ * creating a game, -1 if it touches none or only reads it (grid copies
+ * a snapshot, like list and status)
+ */
+static int command_game(Client *client, int type, const char *data, int len) {
+    static const char *game_commands[] = {
+        "requests", "accept", "reject", "move", "leave", "rematch"
+    };
+    int game_id = -1;
+    
+    if (type == TASK_DISCONNECT) {
+        return client->current_game_id;
+    }
+    
+    if (type == TASK_FRAME) {
+        FrameHeader hdr;
+        CommandMsg cmd;
+        if (len != sizeof(hdr) + sizeof(cmd)) return -1;
+        memcpy(&hdr, data, sizeof(hdr));
+        memcpy(&cmd, data + sizeof(hdr), sizeof(cmd));
+        switch (hdr.type) {
+            case CMD_CREATE:
+            case CMD_PLAY_BOT:
+                return GAME_NEW;
+            case CMD_JOIN:
+                game_id = proto_arg(&cmd);
+                return game_id >= 0 && game_id < table_capacity(&game_table) ? game_id : -1;
+            case CMD_REQUESTS:
+            case CMD_ACCEPT:
+            case CMD_REJECT:
+            case CMD_MOVE:
+            case CMD_LEAVE:
+            case CMD_REMATCH:
+                return client->current_game_id;
+            default:
+                return -1;
         }
     }
     
-cleanup:
-    printf("[SERVER] Client '%s' (#%d) disconnected\n", client->username, client->id);
+    char cmd[64];
+    if (sscanf(data, "%63s", cmd) < 1) return -1;
+    if (strcasecmp(cmd, "create") == 0 || strcasecmp(cmd, "play") == 0) {
+        return GAME_NEW;
+    }
+    if (strcasecmp(cmd, "join") == 0) {
+        if (sscanf(data, "%*s %d", &game_id) != 1) return -1;
+        return game_id >= 0 && game_id < table_capacity(&game_table) ? game_id : -1;
+    }
+    for (size_t i = 0; i < sizeof(game_commands) / sizeof(game_commands[0]); i++) {
+        if (strcasecmp(cmd, game_commands[i]) == 0) return client->current_game_id;
+    }
+    return -1;
+}
+
+// Withdrawal of a departed client's join request, on the strand of the game
+typedef struct JoinWithdrawTask {
+    StrandTask task;
+    int requester_id;
+} JoinWithdrawTask;
+
+static void join_withdraw_run(StrandTask *task) {
+    int requester_id = ((JoinWithdrawTask *)task)->requester_id;
+    free(task);
+    Game *game = (Game *)((char *)strand_current() - offsetof(Game, strand));
+    if (game->is_active) joinq_remove(&game->join_requests, requester_id);
+}
+
+/**
+ * Withdraw the join requests a client may still have pending, each on
+ * the strand of its game; older ones are purged when their game's queue
+ * fills up (see purge_join_requests)
+ */
+static void client_withdraw_requests(Client *client) {
+    int count = client->join_count < CLIENT_JOIN_TRACK ? client->join_count : CLIENT_JOIN_TRACK;
+    for (int i = 0; i < count; i++) {
+        JoinWithdrawTask *withdraw = malloc(sizeof(JoinWithdrawTask));
+        if (!withdraw) return;
+        withdraw->task.run = join_withdraw_run;
+        withdraw->requester_id = client->id;
+        strand_post(&game_at(client->join_games[i])->strand, &withdraw->task);
+    }
+}
+
+/**
+ * Leave any game, withdraw pending join requests, notify the others
+ * and release the client slot
+ */
+static void client_release(Client *client) {
     if (client->current_game_id >= 0) {
         handle_leave(client);
     }
+    client_withdraw_requests(client);
     
     if (client->username[0] != '\0') {
         char leave_msg[BUFFER_SIZE];
         snprintf(leave_msg, sizeof(leave_msg),
             "\n[NOTICE] %s disconnected.\n\n", client->username);
-        broadcast_except(client->id, leave_msg);
+        ClientEventMsg event;
+        proto_client_event(&event, CLIENT_EVENT_DISCONNECTED, client);
+        broadcast_event_except(client->id, leave_msg, MSG_CLIENT_EVENT, &event, sizeof(event));
+        client_unregister_name(client);
+    }
+    
+    release_client(client);
+}
+
+/**
+ * Oldest queued command; only called while one is known to be queued
+ */
+static ClientTask *client_next(Client *client) {
+    if (!client->backlog) {
+        StrandTask *task = __atomic_exchange_n(&client->tasks, NULL, __ATOMIC_ACQUIRE);
+        while (task) {
+            StrandTask *next = task->next;
+            task->next = client->backlog;
+            client->backlog = task;
+            task = next;
+        }
+    }
+    StrandTask *task = client->backlog;
+    client->backlog = task->next;
+    return (ClientTask *)task;
+}
+
+/**
+ * Run a client's queued commands from the head on, for as long as they
+ * need no strand or the one running; the first one that needs another
+ * strand is posted there, and the rest follows from it
+ * Returns -1 when the client asked to quit
+ */
+static int client_run(Client *client, ClientTask *task) {
+    int result = 0;
+    
+    while (task) {
+        int game_id = task->game_id >= 0 ? task->game_id
+                                         : command_game(client, task->type, task->data, task->len);
+        if (game_id == GAME_NEW) {
+            // The game is set up on the strand of its slot, behind any
+            // task its previous game left there
+            game_id = task->game_id = table_alloc(&game_table);
+        }
+        if (game_id >= 0 && strand_current() != &game_at(game_id)->strand) {
+            strand_post(&game_at(game_id)->strand, &task->task);
+            return result;
+        }
+        
+        if (task->type == TASK_DISCONNECT) {
+            // Always the last one: the slot may be reused once released
+            free(task);
+            __atomic_store_n(&client->pending, 0, __ATOMIC_SEQ_CST);
+            client_release(client);
+            return result;
+        }
+        
+        client->opening_game_id = task->game_id;
+        if (!client->hangup) {
+            int quit = task->type == TASK_FRAME
+                     ? handle_frame(client, (unsigned char *)task->data, task->len)
+                     : handle_command(client, task->data);
+            if (quit < 0) {
+                // Stop reading while the count still holds the client:
+                // once it drops, the slot may be released and reused
+                client->hangup = 1;
+                client_hangup(client);
+                result = -1;
+            }
+        }
+        // Taken for a command that did not create its game
+        if (client->opening_game_id >= 0) {
+            table_free(&game_table, client->opening_game_id);
+            client->opening_game_id = -1;
+        }
+        free(task);
+        
+        if (__atomic_sub_fetch(&client->pending, 1, __ATOMIC_SEQ_CST) == 0) break;
+        task = client_next(client);
+    }
+    return result;
+}
+
+static void client_task_run(StrandTask *task) {
+    client_run(((ClientTask *)task)->client, (ClientTask *)task);
+}
+
+/**
+ * Run a command of a client (a line, a frame or its disconnection) now,
+ * or queue it behind the ones it must follow
+ * Returns -1 when the client asked to quit
+ */
+static int client_submit(Client *client, int type, const char *data, int len) {
+    if (client->hangup && type != TASK_DISCONNECT) return -1;
+    
+    ClientTask *task = NULL;
+    if (__atomic_load_n(&client->pending, __ATOMIC_SEQ_CST) > 0 ||
+        command_game(client, type, data, len) != -1) {
+        task = malloc(sizeof(ClientTask) + len + 1);
+    }
+    if (!task) {
+        // Nothing to wait for, or no memory to wait with
+        if (type == TASK_DISCONNECT) {
+            client_release(client);
+            return 0;
+        }
+        return type == TASK_FRAME ? handle_frame(client, (const unsigned char *)data, len)
+                                  : handle_command(client, (char *)data);
     }
     
-    pthread_mutex_lock(&clients_mutex);
-    close(client->socket);
-    client->is_connected = 0;
-    client->socket = -1;
-    pthread_mutex_unlock(&clients_mutex);
+    task->task.run = client_task_run;
+    task->client = client;
+    task->type = type;
+    task->game_id = -1;
+    task->len = len;
+    memcpy(task->data, data, len);
+    task->data[len] = '\0';
+    
+    StrandTask *head = __atomic_load_n(&client->tasks, __ATOMIC_RELAXED);
+    do {
+        task->task.next = head;
+    } while (!__atomic_compare_exchange_n(&client->tasks, &head, &task->task, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    // Queued before being counted: whoever sees the count go up from
+    // zero owns the queue, and finds it there
+    if (__atomic_fetch_add(&client->pending, 1, __ATOMIC_SEQ_CST) > 0) return 0;
+    return client_run(client, client_next(client));
+}
+
+/**
+ * Run every complete line buffered for a client, in order: the first
+ * one is the username, every following one is a command (a frame for
+ * binary protocol clients)
+ * Returns -1 when the connection must be closed
+ */
+int handle_input(Client *client) {
+    char line[LINEBUF_SIZE];
+    
+    for (;;) {
+        if (client->proto == PROTO_BINARY) {
+            int n = linebuf_read_frame(&client->in, (unsigned char *)line, sizeof(line));
+            if (n == -2) return -1;
+            if (n < 0) break;
+            __atomic_store_n(&client->last_active, timer_now(), __ATOMIC_RELAXED);
+            if (client_submit(client, TASK_FRAME, line, n) < 0) return -1;
+            continue;
+        }
+        
+        if (linebuf_read_line(&client->in, line, sizeof(line)) < 0) break;
+        if (strlen(line) == 0) continue;
+        
+        __atomic_store_n(&client->last_active, timer_now(), __ATOMIC_RELAXED);
+        if (client->username[0] == '\0') {
+            client_login(client, line);
+            continue;
+        }
+        if (client_submit(client, TASK_LINE, line, strlen(line)) < 0) return -1;
+    }
+    return 0;
+}
+
+/**
+ * The connection is gone: leave any game and release the slot once
+ * the commands still queued have run
+ */
+void client_disconnect(Client *client) {
+    printf("[SERVER] Client '%s' (#%d) disconnected\n", client->username, client->id);
+    timer_cancel(&client->timer);
+    client_submit(client, TASK_DISCONNECT, "", 0);
+}
+
+/**
+ * Thread body of the thread-per-client model
+ */
+void *handle_client(void *arg) {
+    Client *client = (Client *)arg;
+    ssize_t bytes_read;
+    size_t space;
+    
+    client_welcome(client);
+    
+    while (server_running) {
+        char *ptr = linebuf_write_ptr(&client->in, &space);
+        bytes_read = recv(client->socket, ptr, space, 0);
+        if (bytes_read <= 0) break;
+        linebuf_commit(&client->in, bytes_read);
+        if (handle_input(client) < 0) break;
+    }
+    
+    if (client->username[0] == '\0') {
+        printf("[SERVER] Client #%d disconnected during login\n", client->id);
+    }
+    client_disconnect(client);
     return NULL;
 }
 
@@ -804,6 +1565,9 @@ cleanup:
 
 void handle_signal(int sig) {
     printf("\n[SERVER] Server shutting down...\n");
+    printf("[SERVER] Slow consumers: %lu, notices dropped: %lu, boards coalesced: %lu, evictions: %lu\n",
+           outq_stats.congested, outq_stats.notices_dropped,
+           outq_stats.boards_coalesced, outq_stats.evictions);
     server_running = 0;
     if (server_socket != -1) {
         close(server_socket);
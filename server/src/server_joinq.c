@@ -0,0 +1,138 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#include "../server.h"
+
+// ===============================
+// JOIN REQUEST QUEUES
+// ===============================
+//
+// Every game owns a fixed pool of entries, allocated with its slot: the
+// pending requests are a doubly linked FIFO through the pool, the unused
+// entries a free list, and an open addressing index (twice as many
+// buckets as entries) finds a requester's entry. Adding and removing are
+// O(1) and never allocate; a full pool refuses the request
+
+static int joinq_hash(const JoinQueue *q, int requester_id) {
+    return ((unsigned)requester_id * 2654435761u) & q->index_mask;
+}
+
+/**
+ * Bucket holding the entry of a requester, or the empty bucket where
+ * it would go
+ */
+static int joinq_find(const JoinQueue *q, int requester_id) {
+    int i = joinq_hash(q, requester_id);
+    while (q->index[i] && q->entries[q->index[i] - 1].requester_id != requester_id) {
+        i = (i + 1) & q->index_mask;
+    }
+    return i;
+}
+
+/**
+ * Empty a bucket, shifting back the entries of the same probe run that
+ * would no longer be found past the hole
+ */
+static void joinq_unindex(JoinQueue *q, int bucket) {
+    int hole = bucket;
+    for (int i = (bucket + 1) & q->index_mask; q->index[i]; i = (i + 1) & q->index_mask) {
+        int home = joinq_hash(q, q->entries[q->index[i] - 1].requester_id);
+        if (((i - home) & q->index_mask) >= ((i - hole) & q->index_mask)) {
+            q->index[hole] = q->index[i];
+            hole = i;
+        }
+    }
+    q->index[hole] = 0;
+}
+
+/**
+ * Allocate the pool and index of a queue of at most capacity requests
+ */
+int joinq_init(JoinQueue *q, int capacity) {
+    int buckets = 1;
+    while (buckets < 2 * capacity) buckets <<= 1;
+    q->entries = malloc(capacity * sizeof(JoinRequest));
+    q->index = malloc(buckets * sizeof(int));
+    if (!q->entries || !q->index) {
+        free(q->entries);
+        free(q->index);
+        return -1;
+    }
+    q->index_mask = buckets - 1;
+    for (int i = 0; i < capacity; i++) {
+        q->entries[i].next = i + 1 < capacity ? i + 1 : -1;
+    }
+    memset(q->index, 0, buckets * sizeof(int));
+    q->head = q->tail = -1;
+    q->free = 0;
+    q->count = 0;
+    return 0;
+}
+
+/**
+ * Free the pool and index of a queue
+ */
+void joinq_destroy(JoinQueue *q) {
+    free(q->entries);
+    free(q->index);
+    q->entries = NULL;
+    q->index = NULL;
+}
+
+/**
+ * Drop every pending request
+ */
+void joinq_clear(JoinQueue *q) {
+    while (q->head >= 0) {
+        joinq_remove(q, q->entries[q->head].requester_id);
+    }
+}
+
+/**
+ * Queue a request behind the others
+ * Returns -1 when the requester already has one pending, -2 when the
+ * queue is full
+ */
+int joinq_add(JoinQueue *q, int requester_id) {
+    int bucket = joinq_find(q, requester_id);
+    if (q->index[bucket]) return -1;
+    if (q->free < 0) return -2;
+    
+    int e = q->free;
+    JoinRequest *req = &q->entries[e];
+    q->free = req->next;
+    req->requester_id = requester_id;
+    req->prev = q->tail;
+    req->next = -1;
+    if (q->tail >= 0) q->entries[q->tail].next = e;
+    else q->head = e;
+    q->tail = e;
+    q->index[bucket] = e + 1;
+    q->count++;
+    return 0;
+}
+
+/**
+ * Remove the pending request of a requester
+ * Returns -1 if there is none
+ */
+int joinq_remove(JoinQueue *q, int requester_id) {
+    int bucket = joinq_find(q, requester_id);
+    if (!q->index[bucket]) return -1;
+    
+    int e = q->index[bucket] - 1;
+    JoinRequest *req = &q->entries[e];
+    if (req->prev >= 0) q->entries[req->prev].next = req->next;
+    else q->head = req->next;
+    if (req->next >= 0) q->entries[req->next].prev = req->prev;
+    else q->tail = req->prev;
+    joinq_unindex(q, bucket);
+    req->next = q->free;
+    q->free = e;
+    q->count--;
+    return 0;
+}
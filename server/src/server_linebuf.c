@@ -0,0 +1,116 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#include "../server.h"
+
+// ===============================
+// LINE-FRAMED INPUT BUFFER
+// ===============================
+
+#define LINEBUF_MASK (LINEBUF_SIZE - 1)
+
+void linebuf_reset(LineBuffer *lb) {
+    lb->head = 0;
+    lb->tail = 0;
+    lb->scan = 0;
+    lb->discard = 0;
+}
+
+/**
+ * Contiguous free space where the next recv can write directly
+ */
+char* linebuf_write_ptr(LineBuffer *lb, size_t *space) {
+    unsigned free_bytes = LINEBUF_SIZE - (lb->tail - lb->head);
+    unsigned to_end = LINEBUF_SIZE - (lb->tail & LINEBUF_MASK);
+    *space = free_bytes < to_end ? free_bytes : to_end;
+    return lb->data + (lb->tail & LINEBUF_MASK);
+}
+
+/**
+ * Account for len bytes written at linebuf_write_ptr()
+ */
+void linebuf_commit(LineBuffer *lb, size_t len) {
+    lb->tail += len;
+}
+
+/**
+ * Copy as much data as fits; returns the number of bytes taken
+ */
+size_t linebuf_append(LineBuffer *lb, const char *data, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        size_t space;
+        char *ptr = linebuf_write_ptr(lb, &space);
+        if (space == 0) break;
+        size_t n = (len - done) < space ? (len - done) : space;
+        memcpy(ptr, data + done, n);
+        linebuf_commit(lb, n);
+        done += n;
+    }
+    return done;
+}
+
+/**
+ * Extract the next complete line, without its "\n" and anything from
+ * the first "\r" on. A line that does not fit in the buffer is discarded.
+ * Returns the line length, or -1 when no complete line is buffered
+ */
+int linebuf_read_line(LineBuffer *lb, char *line, size_t size) {
+    for (;;) {
+        while (lb->scan != lb->tail && lb->data[lb->scan & LINEBUF_MASK] != '\n') {
+            lb->scan++;
+        }
+        if (lb->scan == lb->tail) {
+            if (lb->tail - lb->head == LINEBUF_SIZE) {
+                lb->head = lb->tail;
+                lb->discard = 1;
+            }
+            return -1;
+        }
+        
+        size_t n = lb->scan - lb->head;
+        if (n > size - 1) n = size - 1;
+        for (size_t i = 0; i < n; i++) {
+            line[i] = lb->data[(lb->head + i) & LINEBUF_MASK];
+        }
+        line[n] = '\0';
+        lb->head = ++lb->scan;
+        
+        if (lb->discard) {
+            lb->discard = 0;
+            continue;
+        }
+        char *cr = strchr(line, '\r');
+        if (cr) *cr = '\0';
+        return strlen(line);
+    }
+}
+
+/**
+ * Extract the next complete binary protocol frame, header included
+ * Returns its size, -1 if it is not complete yet, -2 if it can never
+ * fit in the ring (the connection must be dropped)
+ */
+int linebuf_read_frame(LineBuffer *lb, unsigned char *frame, size_t size) {
+    unsigned avail = lb->tail - lb->head;
+    if (avail < sizeof(FrameHeader)) return -1;
+    
+    unsigned char hdr[sizeof(FrameHeader)];
+    for (size_t i = 0; i < sizeof(hdr); i++) {
+        hdr[i] = lb->data[(lb->head + i) & LINEBUF_MASK];
+    }
+    size_t n = sizeof(FrameHeader) + ((hdr[0] << 8) | hdr[1]);
+    if (n > size || n > LINEBUF_SIZE) return -2;
+    if (avail < n) return -1;
+    
+    for (size_t i = 0; i < n; i++) {
+        frame[i] = lb->data[(lb->head + i) & LINEBUF_MASK];
+    }
+    lb->head += n;
+    lb->scan = lb->head;
+    return n;
+}
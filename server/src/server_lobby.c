@@ -0,0 +1,150 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#include "../server.h"
+
+// ===============================
+// LOBBY DIRECTORY
+// ===============================
+//
+// The game list is rendered when a game appears, changes creator or
+// state, or goes away, and published as an immutable directory: 'list'
+// loads the current one and copies it, under an epoch instead of a lock.
+// Rebuilds are serialized by lobby_mutex and the replaced directory is
+// retired to the epoch allocator
+
+typedef struct LobbyDir {
+    EpochNode retired;
+    size_t len;
+    char text[BUFFER_SIZE];
+} LobbyDir;
+
+static LobbyDir *current_dir;
+static pthread_mutex_t lobby_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int listed_games;
+
+static void lobby_release(EpochNode *node) {
+    free((LobbyDir *)((char *)node - offsetof(LobbyDir, retired)));
+}
+
+/**
+ * Render the listed games, as many as fit, in id order
+ * (caller holds lobby_mutex)
+ */
+static void lobby_render(LobbyDir *dir) {
+    char *ptr = dir->text;
+    int remaining = sizeof(dir->text);
+    int written;
+    
+    written = snprintf(ptr, remaining,
+        "\n╔═══════════════════════════════════════════════════════════════╗\n"
+        "║                      GAME LIST                                ║\n"
+        "╠═══════════════════════════════════════════════════════════════╣\n");
+    ptr += written; remaining -= written;
+    
+    // Room is kept for the last two lines; the games that do not fit
+    // are only counted
+    int shown = 0;
+    int capacity = table_capacity(&game_table);
+    for (int i = 0; i < capacity && shown < listed_games && remaining >= 3 * LIST_LINE_MAX; i++) {
+        Game *game = game_at(i);
+        if (!game->listed) continue;
+        
+        const char *state_str;
+        switch (game->listed_state) {
+            case GAME_WAITING: state_str = "Waiting"; break;
+            case GAME_IN_PROGRESS: state_str = "In progress"; break;
+            case GAME_FINISHED: state_str = "Finished"; break;
+            default: state_str = "Created"; break;
+        }
+        // Games on another board show it in place of the "Status:" label
+        char label[16] = "Status:";
+        if (game->board.variant != 0) {
+            const Variant *v = board_variant(&game->board);
+            snprintf(label, sizeof(label), "%s/%d", v->name, v->connect);
+        }
+        const char *creator_name = get_username(game->listed_creator);
+        written = snprintf(ptr, LIST_LINE_MAX,
+            "║  Game #%-3d  |  Creator: %-12s |  %-7s %-12s  ║\n",
+            game->id, creator_name, label, state_str);
+        ptr += written; remaining -= written;
+        shown++;
+    }
+    
+    if (shown < listed_games) {
+        char more[64];
+        snprintf(more, sizeof(more), "... and %d more", listed_games - shown);
+        written = snprintf(ptr, remaining, "║  %-61s║\n", more);
+        ptr += written; remaining -= written;
+    }
+    
+    if (listed_games == 0) {
+        written = snprintf(ptr, remaining,
+            "║             No games available                                 ║\n");
+        ptr += written; remaining -= written;
+    }
+    
+    written = snprintf(ptr, remaining,
+        "╚═══════════════════════════════════════════════════════════════╝\n\n");
+    dir->len = ptr + written - dir->text;
+}
+
+/**
+ * Render and publish a new directory (caller holds lobby_mutex)
+ */
+static int lobby_publish(void) {
+    LobbyDir *dir = malloc(sizeof(LobbyDir));
+    if (!dir) return -1;
+    dir->retired.release = lobby_release;
+    lobby_render(dir);
+    
+    LobbyDir *old = __atomic_exchange_n(&current_dir, dir, __ATOMIC_ACQ_REL);
+    if (old) epoch_retire(&old->retired);
+    return 0;
+}
+
+/**
+ * Publish the empty directory
+ */
+int lobby_init(void) {
+    LOCK(&lobby_mutex, LOCK_LOBBY);
+    int result = lobby_publish();
+    UNLOCK(&lobby_mutex);
+    return result;
+}
+
+/**
+ * Refresh the directory after a change of a game, if the change shows
+ * in it (caller is the game's writer, see game_write_begin)
+ */
+void lobby_update(Game *game) {
+    int listed = game->is_active;
+    if (listed == game->listed &&
+        (!listed || (game->state == game->listed_state && game->creator_id == game->listed_creator))) {
+        return;
+    }
+    
+    LOCK(&lobby_mutex, LOCK_LOBBY);
+    listed_games += listed - game->listed;
+    game->listed = listed;
+    game->listed_state = game->state;
+    game->listed_creator = game->creator_id;
+    if (lobby_publish() < 0) {
+        perror("[SERVER] Lobby allocation error");
+    }
+    UNLOCK(&lobby_mutex);
+}
+
+/**
+ * Send the current directory to a client
+ */
+void lobby_send(Client *client) {
+    epoch_enter();
+    LobbyDir *dir = __atomic_load_n(&current_dir, __ATOMIC_ACQUIRE);
+    client_send(client, dir->text, dir->len);
+    epoch_exit();
+}
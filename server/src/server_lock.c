@@ -0,0 +1,58 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#include "../server.h"
+
+// ===============================
+// LOCK ORDER CHECKER
+// ===============================
+//
+// Debug builds only: every thread keeps the stack of the locks it holds,
+// and taking a lock whose level is not above the innermost one held is
+// reported before it can deadlock
+
+#ifdef LOCK_DEBUG
+
+typedef struct HeldLock {
+    pthread_mutex_t *mutex;
+    int level;
+    const char *name;
+} HeldLock;
+
+static __thread HeldLock held[LOCK_DEBUG_DEPTH];
+static __thread int held_count = 0;
+
+void lock_acquire(pthread_mutex_t *mutex, int level, const char *name) {
+    if (held_count > 0 && held[held_count - 1].level >= level) {
+        fprintf(stderr, "[SERVER] Lock order violation: %s (level %d) taken while holding %s (level %d)\n",
+                name, level, held[held_count - 1].name, held[held_count - 1].level);
+        abort();
+    }
+    if (held_count == LOCK_DEBUG_DEPTH) {
+        fprintf(stderr, "[SERVER] Too many locks held taking %s\n", name);
+        abort();
+    }
+    pthread_mutex_lock(mutex);
+    held[held_count].mutex = mutex;
+    held[held_count].level = level;
+    held[held_count].name = name;
+    held_count++;
+}
+
+void lock_release(pthread_mutex_t *mutex) {
+    int i = held_count - 1;
+    while (i >= 0 && held[i].mutex != mutex) i--;
+    if (i < 0) {
+        fprintf(stderr, "[SERVER] Releasing a lock that is not held\n");
+        abort();
+    }
+    for (; i < held_count - 1; i++) held[i] = held[i + 1];
+    held_count--;
+    pthread_mutex_unlock(mutex);
+}
+
+#endif
@@ -0,0 +1,359 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#include "../server.h"
+
+// ===============================
+// OUTBOUND QUEUES
+// ===============================
+
+void outq_init(OutQueue *q) {
+    pthread_mutex_init(&q->lock, NULL);
+    q->head = NULL;
+    q->tail = NULL;
+    q->bytes = 0;
+    q->pinned = 0;
+    q->congested = 0;
+}
+
+#define outq_count(counter) __atomic_add_fetch(&outq_stats.counter, 1, __ATOMIC_RELAXED)
+
+static void outq_chunk_free(OutChunk *chunk) {
+    shared_buffer_release(chunk->shared);
+    free(chunk);
+}
+
+/**
+ * Drop the first bytes of the queue (caller holds q->lock)
+ */
+static void outq_consume_locked(OutQueue *q, size_t bytes) {
+    q->bytes -= bytes;
+    if (q->bytes <= OUTQ_LOW_WATER) q->congested = 0;
+    while (bytes > 0 && q->head) {
+        OutChunk *chunk = q->head;
+        if (bytes < chunk->len) {
+            chunk->len -= bytes;
+            while (bytes > 0) {
+                struct iovec *seg = &chunk->iov[chunk->iov_first];
+                if (bytes < seg->iov_len) {
+                    seg->iov_base = (char *)seg->iov_base + bytes;
+                    seg->iov_len -= bytes;
+                    return;
+                }
+                bytes -= seg->iov_len;
+                chunk->iov_first++;
+            }
+            return;
+        }
+        bytes -= chunk->len;
+        q->head = chunk->next;
+        if (q->pinned > 0) q->pinned--;
+        outq_chunk_free(chunk);
+    }
+    if (!q->head) q->tail = NULL;
+}
+
+void outq_free_chunks(OutChunk *chunk) {
+    while (chunk) {
+        OutChunk *next = chunk->next;
+        outq_chunk_free(chunk);
+        chunk = next;
+    }
+}
+
+/**
+ * Drop the first bytes of the queue once they reached the socket
+ */
+void outq_consume(OutQueue *q, size_t bytes) {
+    LOCK(&q->lock, LOCK_OUTQ);
+    outq_consume_locked(q, bytes);
+    UNLOCK(&q->lock);
+}
+
+/**
+ * Discard everything still queued
+ */
+void outq_clear(OutQueue *q) {
+    outq_free_chunks(outq_detach(q));
+}
+
+/**
+ * Take the whole chunk list out of the queue, leaving it empty
+ */
+OutChunk* outq_detach(OutQueue *q) {
+    LOCK(&q->lock, LOCK_OUTQ);
+    OutChunk *chunks = q->head;
+    q->head = q->tail = NULL;
+    q->bytes = 0;
+    q->pinned = 0;
+    q->congested = 0;
+    UNLOCK(&q->lock);
+    return chunks;
+}
+
+/**
+ * Mark up to max chunks at the head as being written asynchronously:
+ * shedding leaves them alone until outq_unpin()
+ * Returns the first one, count is set to how many were pinned
+ */
+OutChunk* outq_pin(OutQueue *q, int max, int *count) {
+    LOCK(&q->lock, LOCK_OUTQ);
+    OutChunk *first = q->head;
+    int n = 0;
+    for (OutChunk *chunk = first; chunk && n < max; chunk = chunk->next) n++;
+    q->pinned = n;
+    UNLOCK(&q->lock);
+    *count = n;
+    return first;
+}
+
+void outq_unpin(OutQueue *q) {
+    LOCK(&q->lock, LOCK_OUTQ);
+    q->pinned = 0;
+    UNLOCK(&q->lock);
+}
+
+/**
+ * Remove queued notices, and board updates too when a newer one is on
+ * its way (caller holds q->lock)
+ * The head chunk may be partially written and pinned ones are owned by
+ * the transport: only the chunks after them are candidates
+ */
+static void outq_shed_locked(OutQueue *q, int boards) {
+    int keep = q->pinned > 0 ? q->pinned : 1;
+    OutChunk *prev = q->head;
+    for (int i = 1; prev && i < keep; i++) prev = prev->next;
+    if (!prev) return;
+    
+    OutChunk *chunk = prev->next;
+    while (chunk) {
+        OutChunk *next = chunk->next;
+        if (chunk->kind == OUT_NOTICE || (boards && chunk->kind == OUT_BOARD)) {
+            if (chunk->kind == OUT_NOTICE) outq_count(notices_dropped);
+            else outq_count(boards_coalesced);
+            prev->next = next;
+            if (q->tail == chunk) q->tail = prev;
+            q->bytes -= chunk->len;
+            outq_chunk_free(chunk);
+        } else {
+            prev = chunk;
+        }
+        chunk = next;
+    }
+}
+
+/**
+ * Build the chunk for a response: one allocation holding the segment
+ * list followed by the copied segments
+ */
+static OutChunk *outq_chunk_alloc(const Response *r) {
+    OutChunk *chunk = malloc(sizeof(OutChunk) + r->count * sizeof(struct iovec) + r->copy_len);
+    if (!chunk) return NULL;
+    
+    char *data = (char *)&chunk->iov[r->count];
+    for (int i = 0; i < r->count; i++) {
+        if (r->copy[i]) {
+            memcpy(data, r->seg[i].iov_base, r->seg[i].iov_len);
+            chunk->iov[i].iov_base = data;
+            chunk->iov[i].iov_len = r->seg[i].iov_len;
+            data += r->seg[i].iov_len;
+        } else {
+            chunk->iov[i] = r->seg[i];
+        }
+    }
+    chunk->next = NULL;
+    chunk->shared = r->shared;
+    if (chunk->shared) shared_buffer_ref(chunk->shared);
+    chunk->kind = r->kind;
+    chunk->len = r->len;
+    chunk->iov_first = 0;
+    chunk->iov_count = r->count;
+    return chunk;
+}
+
+/**
+ * Append a message to a client's outbound queue, as is
+ * Past the high watermark the client is a slow consumer: lobby notices
+ * are dropped, a board update replaces the queued ones, and the client
+ * is disconnected if its essential messages still reach OUTQ_MAX_BYTES
+ * Returns 1 if the queue was empty (a flush must be scheduled), 0 if a
+ * flush is already pending (or the message was dropped), -1 if the
+ * queue is full: the connection is then shut down so that its owner
+ * disconnects it
+ */
+static int outq_push(Client *client, const Response *r) {
+    OutQueue *q = &client->out;
+    if (r->kind == OUT_NOTICE && __atomic_load_n(&q->congested, __ATOMIC_RELAXED)) {
+        outq_count(notices_dropped);
+        return 0;
+    }
+    
+    OutChunk *chunk = outq_chunk_alloc(r);
+    if (!chunk) return -1;
+    
+    LOCK(&q->lock, LOCK_OUTQ);
+    if (client->socket < 0) {
+        UNLOCK(&q->lock);
+        outq_chunk_free(chunk);
+        return -1;
+    }
+    if (q->congested || q->bytes + r->len > OUTQ_HIGH_WATER) {
+        if (!q->congested) {
+            q->congested = 1;
+            outq_count(congested);
+        }
+        if (r->kind == OUT_NOTICE) {
+            UNLOCK(&q->lock);
+            outq_chunk_free(chunk);
+            outq_count(notices_dropped);
+            return 0;
+        }
+        outq_shed_locked(q, r->kind == OUT_BOARD);
+    }
+    if (q->bytes + r->len > OUTQ_MAX_BYTES) {
+        printf("[SERVER] Client #%d output queue full, disconnecting\n", client->id);
+        shutdown(client->socket, SHUT_RDWR);
+        UNLOCK(&q->lock);
+        outq_chunk_free(chunk);
+        outq_count(evictions);
+        return -1;
+    }
+    int was_empty = q->head == NULL;
+    if (q->tail) q->tail->next = chunk;
+    else q->head = chunk;
+    q->tail = chunk;
+    q->bytes += r->len;
+    UNLOCK(&q->lock);
+    return was_empty;
+}
+
+/**
+ * Append a text response to a client's outbound queue; binary protocol
+ * clients get it in a MSG_TEXT frame
+ * Same return values as outq_push()
+ */
+int client_enqueue_response(Client *client, const Response *r) {
+    if (r->len == 0) return 0;
+    if (client->proto == PROTO_BINARY) {
+        Response framed;
+        FrameHeader hdr;
+        proto_frame_text(&framed, &hdr, r);
+        return outq_push(client, &framed);
+    }
+    return outq_push(client, r);
+}
+
+/**
+ * Append an event: binary protocol clients get the fixed size message,
+ * text clients the rendered response (type MSG_TEXT: text only)
+ */
+int client_enqueue_event(Client *client, const Response *text, int type, const void *payload, size_t len) {
+    if (client->proto == PROTO_BINARY && type != MSG_TEXT) {
+        Response frame;
+        FrameHeader hdr;
+        proto_frame(&frame, &hdr, type, payload, len);
+        if (text->kind == OUT_NOTICE) frame.kind = OUT_NOTICE;
+        else if (type == MSG_BOARD) frame.kind = OUT_BOARD;
+        return outq_push(client, &frame);
+    }
+    return client_enqueue_response(client, text);
+}
+
+/**
+ * Append a copy of data to a client's outbound queue
+ * Same return values as outq_push()
+ */
+int client_enqueue(Client *client, const char *data, size_t len) {
+    Response r;
+    response_init(&r);
+    response_copy(&r, data, len);
+    return client_enqueue_response(client, &r);
+}
+
+/**
+ * Write as much queued data as the socket accepts without blocking, all
+ * queued chunks in a single sendmsg, handling partial writes; the rest
+ * waits for the socket to be writable
+ * Returns the number of bytes still queued, -1 on a socket error
+ */
+ssize_t client_flush(Client *client) {
+    OutQueue *q = &client->out;
+    struct iovec iov[OUTQ_MAX_IOV];
+    
+    LOCK(&q->lock, LOCK_OUTQ);
+    while (q->head && client->socket >= 0) {
+        int n = 0;
+        for (OutChunk *chunk = q->head; chunk && n < OUTQ_MAX_IOV; chunk = chunk->next) {
+            for (int i = chunk->iov_first; i < chunk->iov_count && n < OUTQ_MAX_IOV; i++) {
+                iov[n++] = chunk->iov[i];
+            }
+        }
+        
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = n;
+        ssize_t sent = sendmsg(client->socket, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            shutdown(client->socket, SHUT_RDWR);
+            UNLOCK(&q->lock);
+            outq_clear(q);
+            return -1;
+        }
+        outq_consume_locked(q, sent);
+    }
+    ssize_t left = q->bytes;
+    UNLOCK(&q->lock);
+    return left;
+}
+
+/**
+ * Close a connection from any thread: its owner notices the shutdown
+ * and disconnects it as usual. The reason is written only if nothing
+ * else is pending, so that it cannot overtake queued data
+ */
+void client_expire(Client *client, const char *reason) {
+    OutQueue *q = &client->out;
+    LOCK(&q->lock, LOCK_OUTQ);
+    if (client->socket >= 0) {
+        if (!q->head) send(client->socket, reason, strlen(reason), MSG_DONTWAIT | MSG_NOSIGNAL);
+        shutdown(client->socket, SHUT_RDWR);
+    }
+    UNLOCK(&q->lock);
+}
+
+/**
+ * Stop reading from a client from any thread: its owner notices the
+ * end of input and disconnects it after writing what is still queued
+ */
+void client_hangup(Client *client) {
+    OutQueue *q = &client->out;
+    LOCK(&q->lock, LOCK_OUTQ);
+    if (client->socket >= 0) {
+        shutdown(client->socket, SHUT_RD);
+    }
+    UNLOCK(&q->lock);
+}
+
+/**
+ * Close a client socket, making a last non-blocking attempt to
+ * deliver what is still queued (e.g. the goodbye message)
+ */
+void client_close_socket(Client *client) {
+    client_flush(client);
+    
+    OutQueue *q = &client->out;
+    LOCK(&q->lock, LOCK_OUTQ);
+    if (client->socket >= 0) {
+        close(client->socket);
+        client->socket = -1;
+    }
+    UNLOCK(&q->lock);
+    outq_clear(q);
+}
@@ -0,0 +1,89 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#include "../server.h"
+#include <limits.h>
+
+// ===============================
+// BINARY PROTOCOL
+// ===============================
+
+/**
+ * Start a frame in r; hdr must stay valid until r is queued
+ */
+static void proto_header(Response *r, FrameHeader *hdr, uint8_t type, size_t len) {
+    hdr->len = htons(len);
+    hdr->type = type;
+    response_init(r);
+    response_copy(r, (const char *)hdr, sizeof(*hdr));
+}
+
+/**
+ * Build a frame carrying one of the fixed size messages
+ */
+void proto_frame(Response *r, FrameHeader *hdr, uint8_t type, const void *payload, size_t len) {
+    proto_header(r, hdr, type, len);
+    response_copy(r, payload, len);
+}
+
+/**
+ * Wrap a text response into a MSG_TEXT frame, keeping its segments
+ */
+void proto_frame_text(Response *r, FrameHeader *hdr, const Response *text) {
+    proto_header(r, hdr, MSG_TEXT, text->len);
+    for (int i = 0; i < text->count; i++) {
+        if (text->copy[i]) response_copy(r, text->seg[i].iov_base, text->seg[i].iov_len);
+        else response_static(r, text->seg[i].iov_base, text->seg[i].iov_len);
+    }
+    r->shared = text->shared;
+    r->kind = text->kind;
+}
+
+/**
+ * Argument of a command, -1 if it is out of the range of ids
+ */
+int proto_arg(const CommandMsg *cmd) {
+    uint32_t arg = ntohl(cmd->arg);
+    return arg > INT_MAX ? -1 : (int)arg;
+}
+
+uint32_t proto_id(int id) {
+    return htonl(id < 0 ? PROTO_NO_ID : (uint32_t)id);
+}
+
+/**
+ * Fill a BoardMsg; only the cells of the game's board are sent
+ * Returns the size of the message
+ */
+size_t proto_board(Game *game, BoardMsg *msg) {
+    const Variant *v = board_variant(&game->board);
+    msg->game_id = proto_id(game->id);
+    msg->state = game->state;
+    msg->rows = v->rows;
+    msg->cols = v->cols;
+    msg->turn = proto_id(game->state == GAME_IN_PROGRESS ? game->current_turn : -1);
+    for (int r = 0; r < v->rows; r++) {
+        for (int c = 0; c < v->cols; c++) {
+            msg->cells[r * v->cols + c] = board_cell(&game->board, r, c);
+        }
+    }
+    return offsetof(BoardMsg, cells) + v->rows * v->cols;
+}
+
+void proto_game_event(GameEventMsg *msg, int event, int game_id, int player1, int player2) {
+    msg->event = event;
+    msg->game_id = proto_id(game_id);
+    msg->player1 = proto_id(player1);
+    msg->player2 = proto_id(player2);
+}
+
+void proto_client_event(ClientEventMsg *msg, int event, Client *client) {
+    msg->event = event;
+    msg->client_id = proto_id(client->id);
+    memset(msg->username, 0, sizeof(msg->username));
+    memcpy(msg->username, client->username, strnlen(client->username, sizeof(msg->username) - 1));
+}
@@ -0,0 +1,301 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#include "../server.h"
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+// ===============================
+// EPOLL REACTORS
+// ===============================
+
+static Reactor reactors[MAX_REACTORS];
+static __thread Reactor *current_reactor = NULL;
+
+/**
+ * Put a file descriptor in non-blocking mode
+ */
+static int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) return -1;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/**
+ * Ask a reactor to flush a client it owns
+ * The reactor is only woken up when its inbox was empty
+ */
+void reactor_post(Reactor *reactor, Client *client) {
+    ReactorMsg *msg = malloc(sizeof(ReactorMsg));
+    if (!msg) return;
+    msg->client = client;
+    msg->client_id = client->id;
+    
+    ReactorMsg *head = __atomic_load_n(&reactor->inbox, __ATOMIC_RELAXED);
+    do {
+        msg->next = head;
+    } while (!__atomic_compare_exchange_n(&reactor->inbox, &head, msg, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    if (head == NULL) {
+        uint64_t one = 1;
+        if (write(reactor->wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            perror("[SERVER] eventfd write error");
+        }
+    }
+}
+
+/**
+ * Queue a client for the flush that ends the current batch of events
+ */
+static void reactor_schedule_flush(Reactor *reactor, Client *client) {
+    // Marked with the reactor id: a slot reused by another reactor
+    // must not inherit the mark of its previous owner
+    if (client->flush_scheduled != reactor->id + 1) {
+        client->flush_scheduled = reactor->id + 1;
+        reactor->pending[reactor->pending_count++] = client;
+    }
+}
+
+/**
+ * Handle every flush request posted to this reactor
+ */
+static void reactor_drain_inbox(Reactor *reactor) {
+    uint64_t count;
+    if (read(reactor->wake_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        perror("[SERVER] eventfd read error");
+    }
+    
+    ReactorMsg *msg = __atomic_exchange_n(&reactor->inbox, NULL, __ATOMIC_ACQUIRE);
+    while (msg) {
+        ReactorMsg *next = msg->next;
+        Client *client = msg->client;
+        // Released by a game worker meanwhile, or reused: nothing to flush
+        if (client->is_connected && client->id == msg->client_id) {
+            reactor_schedule_flush(reactor, client);
+        }
+        free(msg);
+        msg = next;
+    }
+}
+
+/**
+ * Write the queued replies of every client touched during the batch:
+ * several replies to the same client leave in a single sendmsg
+ */
+static void reactor_flush_pending(Reactor *reactor) {
+    for (int i = 0; i < reactor->pending_count; i++) {
+        Client *client = reactor->pending[i];
+        if (client->flush_scheduled == reactor->id + 1) {
+            client->flush_scheduled = 0;
+        }
+        client_flush(client);
+    }
+    reactor->pending_count = 0;
+}
+
+/**
+ * The owner of the client writes its queue at the end of its current
+ * batch, or when the socket becomes writable again
+ */
+static void reactor_kick(Client *client) {
+    int owner = client->reactor_id;
+    if (owner < 0) {
+        client_flush(client);
+    } else if (current_reactor && owner == current_reactor->id) {
+        reactor_schedule_flush(current_reactor, client);
+    } else {
+        reactor_post(&reactors[owner], client);
+    }
+}
+
+/**
+ * Accept every pending connection (edge-triggered: drain until EAGAIN)
+ */
+static void reactor_accept(Reactor *reactor) {
+    while (server_running) {
+        struct sockaddr_in client_addr;
+        socklen_t client_len = sizeof(client_addr);
+        int client_socket = accept(reactor->listen_fd, (struct sockaddr *)&client_addr, &client_len);
+        
+        if (client_socket < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("[SERVER] Accept error");
+            }
+            return;
+        }
+        
+        Client *client = accept_client(client_socket, &client_addr, reactor->id);
+        if (!client) continue;
+        
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = client;
+        if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, client_socket, &ev) < 0) {
+            perror("[SERVER] epoll_ctl error");
+            client_disconnect(client);
+            continue;
+        }
+        client_welcome(client);
+    }
+}
+
+/**
+ * Read everything available on a client socket straight into its
+ * input ring, running the complete commands after every read
+ * Returns -1 when the connection must be closed
+ */
+static int reactor_read(Client *client) {
+    size_t space;
+    
+    for (;;) {
+        char *ptr = linebuf_write_ptr(&client->in, &space);
+        ssize_t bytes_read = recv(client->socket, ptr, space, MSG_DONTWAIT);
+        if (bytes_read > 0) {
+            linebuf_commit(&client->in, bytes_read);
+            if (handle_input(client) < 0) return -1;
+            continue;
+        }
+        if (bytes_read == 0) return -1;
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+        return -1;
+    }
+}
+
+/**
+ * Create the epoll instance and register the listener and the wakeup eventfd
+ */
+static int reactor_init(Reactor *reactor, int id, int listen_fd) {
+    struct epoll_event ev;
+    
+    reactor->id = id;
+    reactor->listen_fd = listen_fd;
+    reactor->inbox = NULL;
+    reactor->pending_count = 0;
+    reactor->pending = calloc(config.max_clients, sizeof(Client *));
+    if (!reactor->pending) {
+        perror("[SERVER] Reactor allocation error");
+        return -1;
+    }
+    if (set_nonblocking(listen_fd) < 0) {
+        perror("[SERVER] fcntl error");
+        return -1;
+    }
+    
+    reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (reactor->epoll_fd < 0) {
+        perror("[SERVER] epoll_create error");
+        return -1;
+    }
+    
+    reactor->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (reactor->wake_fd < 0) {
+        perror("[SERVER] eventfd error");
+        close(reactor->epoll_fd);
+        return -1;
+    }
+    
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev) < 0) {
+        perror("[SERVER] epoll_ctl error");
+        return -1;
+    }
+    
+    ev.events = EPOLLIN;
+    ev.data.ptr = reactor;
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->wake_fd, &ev) < 0) {
+        perror("[SERVER] epoll_ctl error");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Event loop of one reactor: it owns its listener and every client it
+ * accepted, and runs the command handlers as soon as data is available
+ */
+static void *reactor_loop(void *arg) {
+    Reactor *reactor = (Reactor *)arg;
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    current_reactor = reactor;
+    
+    while (server_running) {
+        int n = epoll_wait(reactor->epoll_fd, events, REACTOR_MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("[SERVER] epoll_wait error");
+            break;
+        }
+        
+        for (int i = 0; i < n; i++) {
+            void *ptr = events[i].data.ptr;
+            if (!ptr) {
+                reactor_accept(reactor);
+                continue;
+            }
+            if (ptr == reactor) {
+                reactor_drain_inbox(reactor);
+                continue;
+            }
+            Client *client = (Client *)ptr;
+            if ((events[i].events & EPOLLOUT) && client_flush(client) < 0) {
+                events[i].events |= EPOLLHUP;
+            }
+            if (!(events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+                continue;
+            }
+            if (reactor_read(client) < 0) {
+                epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, client->socket, NULL);
+                if (client->username[0] == '\0') {
+                    printf("[SERVER] Client #%d disconnected during login\n", client->id);
+                }
+                client_disconnect(client);
+            }
+        }
+        reactor_flush_pending(reactor);
+    }
+    close(reactor->wake_fd);
+    close(reactor->epoll_fd);
+    return NULL;
+}
+
+/**
+ * Start config.reactors reactors; the first one reuses the main listener
+ * and runs on the calling thread, the others bind their own listener to
+ * the same port so that the kernel spreads new connections across them
+ */
+int reactor_run(int listen_fd) {
+    if (reactor_init(&reactors[0], 0, listen_fd) < 0) {
+        return -1;
+    }
+    
+    for (int i = 1; i < config.reactors; i++) {
+        int fd = open_listener(config.port);
+        if (fd < 0 || reactor_init(&reactors[i], i, fd) < 0) {
+            fprintf(stderr, "[SERVER] Reactor #%d could not start\n", i);
+            exit(EXIT_FAILURE);
+        }
+        if (pthread_create(&reactors[i].thread, NULL, reactor_loop, &reactors[i]) != 0) {
+            perror("[SERVER] Thread creation error");
+            exit(EXIT_FAILURE);
+        }
+        pthread_detach(reactors[i].thread);
+    }
+    
+    reactor_loop(&reactors[0]);
+    return 0;
+}
+
+const Transport epoll_transport = {
+    .name = "epoll",
+    .run = reactor_run,
+    .kick = reactor_kick,
+    .fallback = NULL,
+};
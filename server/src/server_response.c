@@ -0,0 +1,92 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#include "../server.h"
+
+// ===============================
+// RESPONSE BUILDER
+// ===============================
+
+void response_init(Response *r) {
+    r->count = 0;
+    r->shared = NULL;
+    r->kind = OUT_ESSENTIAL;
+    r->len = 0;
+    r->copy_len = 0;
+}
+
+static void response_add(Response *r, const char *data, size_t len, int copy) {
+    if (len == 0) return;
+    if (r->count == RESPONSE_MAX_SEGMENTS) {
+        fprintf(stderr, "[SERVER] Response has too many segments, truncated\n");
+        return;
+    }
+    r->seg[r->count].iov_base = (void *)data;
+    r->seg[r->count].iov_len = len;
+    r->copy[r->count] = copy;
+    r->count++;
+    r->len += len;
+    if (copy) r->copy_len += len;
+}
+
+/**
+ * Reference text that outlives every queue (string literals, tables)
+ */
+void response_static(Response *r, const char *text, size_t len) {
+    response_add(r, text, len, 0);
+}
+
+/**
+ * Data that is copied when the response is queued (grid, usernames...)
+ */
+void response_copy(Response *r, const char *data, size_t len) {
+    response_add(r, data, len, 1);
+}
+
+void response_string(Response *r, const char *str) {
+    response_add(r, str, strlen(str), 1);
+}
+
+/**
+ * Reference a shared buffer: every queued chunk takes its own reference
+ * Only one shared buffer per response
+ */
+void response_shared(Response *r, SharedBuffer *buf) {
+    if (r->shared) {
+        fprintf(stderr, "[SERVER] Response already references a shared buffer\n");
+        return;
+    }
+    r->shared = buf;
+    response_add(r, buf->data, buf->len, 0);
+}
+
+// ===============================
+// SHARED BUFFERS
+// ===============================
+
+/**
+ * Render a message once for many recipients; the caller owns one
+ * reference and releases it once the message is queued everywhere
+ */
+SharedBuffer *shared_buffer_create(const char *data, size_t len) {
+    SharedBuffer *buf = malloc(sizeof(SharedBuffer) + len);
+    if (!buf) return NULL;
+    buf->refs = 1;
+    buf->len = len;
+    memcpy(buf->data, data, len);
+    return buf;
+}
+
+void shared_buffer_ref(SharedBuffer *buf) {
+    __atomic_add_fetch(&buf->refs, 1, __ATOMIC_RELAXED);
+}
+
+void shared_buffer_release(SharedBuffer *buf) {
+    if (buf && __atomic_sub_fetch(&buf->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(buf);
+    }
+}
@@ -0,0 +1,81 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#include "../server.h"
+
+// ===============================
+// SLOT ALLOCATOR
+// ===============================
+//
+// One bit per slot, set while the slot is free, and one summary bit per
+// word, set while the word may have a free slot. Allocation finds a word
+// through the summary and claims its lowest bit with a CAS, so it looks at
+// one summary word per 4096 slots at most and never takes a lock. A summary
+// bit may be stale in the "set" direction only: whoever empties a word
+// clears its bit and then checks the word again
+
+#define SLOT_BIT(i) (1ULL << ((i) % SLOT_WORD_BITS))
+
+/**
+ * Set up a map for count slots, all of them taken: slot_free() makes
+ * them available as the storage behind them is allocated
+ */
+int slots_init(SlotMap *map, int count) {
+    map->nwords = (count + SLOT_WORD_BITS - 1) / SLOT_WORD_BITS;
+    map->nsummary = (map->nwords + SLOT_WORD_BITS - 1) / SLOT_WORD_BITS;
+    map->words = calloc(map->nwords, sizeof(uint64_t));
+    map->summary = calloc(map->nsummary, sizeof(uint64_t));
+    if (!map->words || !map->summary) {
+        free(map->words);
+        free(map->summary);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * A word was found empty: drop its summary bit, unless a slot was
+ * freed in it meanwhile
+ */
+static void slot_word_drained(SlotMap *map, int w) {
+    __atomic_and_fetch(&map->summary[w / SLOT_WORD_BITS], ~SLOT_BIT(w), __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&map->words[w], __ATOMIC_SEQ_CST)) {
+        __atomic_or_fetch(&map->summary[w / SLOT_WORD_BITS], SLOT_BIT(w), __ATOMIC_SEQ_CST);
+    }
+}
+
+/**
+ * Claim the lowest free slot
+ * Returns -1 when every slot is taken
+ */
+int slot_alloc(SlotMap *map) {
+    for (int s = 0; s < map->nsummary; s++) {
+        uint64_t candidates = __atomic_load_n(&map->summary[s], __ATOMIC_SEQ_CST);
+        while (candidates) {
+            int w = s * SLOT_WORD_BITS + __builtin_ctzll(candidates);
+            candidates &= candidates - 1;
+            
+            uint64_t word = __atomic_load_n(&map->words[w], __ATOMIC_SEQ_CST);
+            while (word) {
+                uint64_t bit = word & -word;
+                if (__atomic_compare_exchange_n(&map->words[w], &word, word & ~bit, 1,
+                                                __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+                    if (word == bit) slot_word_drained(map, w);
+                    return w * SLOT_WORD_BITS + __builtin_ctzll(bit);
+                }
+            }
+            slot_word_drained(map, w);
+        }
+    }
+    return -1;
+}
+
+void slot_free(SlotMap *map, int slot) {
+    int w = slot / SLOT_WORD_BITS;
+    __atomic_or_fetch(&map->words[w], SLOT_BIT(slot), __ATOMIC_SEQ_CST);
+    __atomic_or_fetch(&map->summary[w / SLOT_WORD_BITS], SLOT_BIT(w), __ATOMIC_SEQ_CST);
+}
@@ -0,0 +1,132 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#include "../server.h"
+
+// ===============================
+// STRANDS AND WORKER POOL
+// ===============================
+//
+// A strand is an actor: tasks are posted to its lock-free inbox from any
+// thread, and whoever makes it non-idle puts it on the run queue. A worker
+// takes it from there and runs the whole batch in posting order; since a
+// strand is on the run queue or on a worker at most once, its tasks never
+// run concurrently and the state it guards needs no lock
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    Strand *head;
+    Strand *tail;
+} run_queue = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, NULL };
+
+static __thread Strand *current_strand = NULL;
+
+void strand_init(Strand *strand) {
+    strand->inbox = NULL;
+    strand->scheduled = 0;
+    strand->next_ready = NULL;
+}
+
+/**
+ * Strand whose tasks the calling thread is running, NULL outside the pool
+ */
+Strand *strand_current(void) {
+    return current_strand;
+}
+
+static void strand_schedule(Strand *strand) {
+    LOCK(&run_queue.lock, LOCK_RUN_QUEUE);
+    strand->next_ready = NULL;
+    if (run_queue.tail) run_queue.tail->next_ready = strand;
+    else run_queue.head = strand;
+    run_queue.tail = strand;
+    pthread_cond_signal(&run_queue.ready);
+    UNLOCK(&run_queue.lock);
+}
+
+/**
+ * Queue a task on a strand; it runs after every task posted before it
+ */
+void strand_post(Strand *strand, StrandTask *task) {
+    StrandTask *head = __atomic_load_n(&strand->inbox, __ATOMIC_RELAXED);
+    do {
+        task->next = head;
+    } while (!__atomic_compare_exchange_n(&strand->inbox, &head, task, 1,
+                                          __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+    if (!__atomic_exchange_n(&strand->scheduled, 1, __ATOMIC_SEQ_CST)) {
+        strand_schedule(strand);
+    }
+}
+
+/**
+ * Run the tasks posted so far, oldest first
+ */
+static void strand_run(Strand *strand) {
+    StrandTask *batch = __atomic_exchange_n(&strand->inbox, NULL, __ATOMIC_ACQUIRE);
+    StrandTask *task = NULL;
+    while (batch) {
+        StrandTask *next = batch->next;
+        batch->next = task;
+        task = batch;
+        batch = next;
+    }
+    
+    current_strand = strand;
+    while (task) {
+        StrandTask *next = task->next;
+        task->run(task);
+        task = next;
+    }
+    current_strand = NULL;
+    
+    // Tasks posted while running saw the strand as scheduled: go back
+    // on the run queue for them, unless a poster already did
+    __atomic_store_n(&strand->scheduled, 0, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&strand->inbox, __ATOMIC_SEQ_CST) &&
+        !__atomic_exchange_n(&strand->scheduled, 1, __ATOMIC_SEQ_CST)) {
+        strand_schedule(strand);
+    }
+}
+
+static void *strand_worker(void *arg) {
+    (void)arg;
+    for (;;) {
+        LOCK(&run_queue.lock, LOCK_RUN_QUEUE);
+        while (!run_queue.head) {
+            pthread_cond_wait(&run_queue.ready, &run_queue.lock);
+        }
+        Strand *strand = run_queue.head;
+        run_queue.head = strand->next_ready;
+        if (!run_queue.head) run_queue.tail = NULL;
+        UNLOCK(&run_queue.lock);
+        
+        strand_run(strand);
+    }
+    return NULL;
+}
+
+/**
+ * Start one worker per online core
+ * Returns the number of workers, -1 if none could be started
+ */
+int strand_pool_start(void) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int count = cores < 1 ? 1 : cores > STRAND_MAX_WORKERS ? STRAND_MAX_WORKERS : (int)cores;
+    
+    int started = 0;
+    for (int i = 0; i < count; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, strand_worker, NULL) != 0) {
+            perror("[SERVER] Worker thread creation error");
+            break;
+        }
+        pthread_detach(thread);
+        started++;
+    }
+    return started > 0 ? started : -1;
+}
@@ -0,0 +1,105 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#include "../server.h"
+
+// ===============================
+// SEGMENTED TABLES
+// ===============================
+//
+// Elements live in segments of TABLE_SEGMENT_SIZE, allocated when the
+// table runs out of free slots and never moved or freed: a pointer to an
+// element stays valid for the life of the server. A segment is set up and
+// published before the capacity covers it, and its slots are handed to
+// the allocator last, so a slot below the capacity is always backed
+
+/**
+ * Number of slots backed by a segment
+ */
+int table_capacity(const Table *table) {
+    return __atomic_load_n(&table->capacity, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Add a segment (caller holds grow_lock)
+ * Returns -1 when the table reached its limit or memory is exhausted
+ */
+static int table_grow(Table *table) {
+    int capacity = table->capacity;
+    if (capacity >= table->limit) return -1;
+    
+    // Cache line aligned, like the elements' own hot fields
+    char *segment;
+    if (posix_memalign((void **)&segment, CACHE_LINE, TABLE_SEGMENT_SIZE * table->elem_size) != 0) {
+        return -1;
+    }
+    memset(segment, 0, TABLE_SEGMENT_SIZE * table->elem_size);
+    
+    int count = table->limit - capacity < TABLE_SEGMENT_SIZE ? table->limit - capacity : TABLE_SEGMENT_SIZE;
+    for (int i = 0; i < count; i++) {
+        if (table->init(segment + i * table->elem_size, capacity + i) < 0) {
+            // Undo the elements set up so far
+            while (table->destroy && i-- > 0) {
+                table->destroy(segment + i * table->elem_size);
+            }
+            free(segment);
+            return -1;
+        }
+    }
+    table->segments[capacity >> TABLE_SEGMENT_BITS] = segment;
+    __atomic_store_n(&table->capacity, capacity + count, __ATOMIC_RELEASE);
+    for (int i = 0; i < count; i++) {
+        slot_free(&table->free, capacity + i);
+    }
+    return 0;
+}
+
+/**
+ * Set up a table of at most limit elements, with its first segment
+ * init is called once on every element, when its segment is allocated,
+ * and fails the growth by returning -1; destroy then releases what init
+ * set up for the elements before it (NULL if there is nothing to release)
+ */
+int table_init(Table *table, size_t elem_size, int limit,
+               int (*init)(void *elem, int slot), void (*destroy)(void *elem)) {
+    int nsegments = (limit + TABLE_SEGMENT_SIZE - 1) / TABLE_SEGMENT_SIZE;
+    table->segments = calloc(nsegments, sizeof(char *));
+    if (!table->segments || slots_init(&table->free, limit) < 0) {
+        free(table->segments);
+        return -1;
+    }
+    table->elem_size = elem_size;
+    table->capacity = 0;
+    table->limit = limit;
+    table->init = init;
+    table->destroy = destroy;
+    pthread_mutex_init(&table->grow_lock, NULL);
+    return table_grow(table);
+}
+
+/**
+ * Claim a free slot, growing the table when none is left
+ * Allocation itself is lock-free, only growing is serialized
+ * Returns -1 when the table is full
+ */
+int table_alloc(Table *table) {
+    int slot = slot_alloc(&table->free);
+    if (slot >= 0) return slot;
+    
+    LOCK(&table->grow_lock, LOCK_TABLE);
+    // Another thread may have grown it meanwhile
+    slot = slot_alloc(&table->free);
+    while (slot < 0 && table_grow(table) == 0) {
+        slot = slot_alloc(&table->free);
+    }
+    UNLOCK(&table->grow_lock);
+    return slot;
+}
+
+void table_free(Table *table, int slot) {
+    slot_free(&table->free, slot);
+}
@@ -0,0 +1,162 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#include "../server.h"
+
+// ===============================
+// HIERARCHICAL TIMER WHEEL
+// ===============================
+//
+// Level l has TIMER_SLOTS slots of TIMER_SLOTS^l ticks each. A timer is
+// filed in the lowest level whose span covers its delay; when the lower
+// level wraps around, the next slot of the level above is cascaded down.
+// Arming and cancelling are O(1), every tick touches one slot per level
+// at most. A single thread drives the wheel
+
+#define TIMER_MASK (TIMER_SLOTS - 1)
+
+static Timer *wheel[TIMER_LEVELS][TIMER_SLOTS];
+static unsigned long wheel_now;
+static pthread_mutex_t wheel_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t timer_thread;
+
+void timer_init(Timer *timer, void (*expired)(Timer *timer)) {
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expired = expired;
+}
+
+/**
+ * Current time in ticks since the wheel started
+ */
+unsigned long timer_now(void) {
+    return __atomic_load_n(&wheel_now, __ATOMIC_RELAXED);
+}
+
+/**
+ * File a timer in its slot (caller holds wheel_mutex)
+ */
+static void timer_link(Timer *timer) {
+    unsigned long delta = timer->expires - wheel_now;
+    int level = 0;
+    while (level < TIMER_LEVELS - 1 && delta >= 1UL << ((level + 1) * TIMER_SLOT_BITS)) {
+        level++;
+    }
+    if (delta >= 1UL << (TIMER_LEVELS * TIMER_SLOT_BITS)) {
+        timer->expires = wheel_now + (1UL << (TIMER_LEVELS * TIMER_SLOT_BITS)) - 1;
+    }
+    
+    Timer **slot = &wheel[level][(timer->expires >> (level * TIMER_SLOT_BITS)) & TIMER_MASK];
+    timer->next = *slot;
+    if (*slot) (*slot)->pprev = &timer->next;
+    timer->pprev = slot;
+    *slot = timer;
+}
+
+static void timer_unlink(Timer *timer) {
+    if (!timer->pprev) return;
+    *timer->pprev = timer->next;
+    if (timer->next) timer->next->pprev = timer->pprev;
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+/**
+ * (Re)arm a timer to expire in the given number of ticks
+ * tag is handed back on expiry, to tell whether the owner is still the
+ * one it was armed for
+ */
+void timer_arm(Timer *timer, unsigned long ticks, int tag) {
+    LOCK(&wheel_mutex, LOCK_WHEEL);
+    timer_unlink(timer);
+    timer->expires = wheel_now + (ticks > 0 ? ticks : 1);
+    timer->tag = tag;
+    timer_link(timer);
+    UNLOCK(&wheel_mutex);
+}
+
+void timer_cancel(Timer *timer) {
+    LOCK(&wheel_mutex, LOCK_WHEEL);
+    timer_unlink(timer);
+    UNLOCK(&wheel_mutex);
+}
+
+/**
+ * Advance the wheel by one tick, moving expired timers to the list
+ * (caller holds wheel_mutex)
+ */
+static void timer_tick(Timer **expired) {
+    wheel_now++;
+    
+    // Cascade: each level whose lower one wrapped around is spread again
+    for (int level = 1; level < TIMER_LEVELS; level++) {
+        if (wheel_now & ((1UL << (level * TIMER_SLOT_BITS)) - 1)) break;
+        Timer **slot = &wheel[level][(wheel_now >> (level * TIMER_SLOT_BITS)) & TIMER_MASK];
+        Timer *timer = *slot;
+        *slot = NULL;
+        while (timer) {
+            Timer *next = timer->next;
+            timer_link(timer);
+            timer = next;
+        }
+    }
+    
+    Timer **slot = &wheel[0][wheel_now & TIMER_MASK];
+    while (*slot) {
+        Timer *timer = *slot;
+        timer_unlink(timer);
+        timer->fire_next = *expired;
+        *expired = timer;
+    }
+}
+
+static void *timer_loop(void *arg) {
+    (void)arg;
+    struct timespec start, next;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    next = start;
+    
+    while (server_running) {
+        next.tv_nsec += TIMER_TICK_MS * 1000000L;
+        if (next.tv_nsec >= 1000000000L) {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000L;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR);
+    
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        unsigned long target = ((now.tv_sec - start.tv_sec) * 1000L
+                              + (now.tv_nsec - start.tv_nsec) / 1000000L) / TIMER_TICK_MS;
+    
+        // Expired timers are called without the lock held: they may be
+        // re-armed meanwhile, which does not touch fire_next
+        Timer *expired = NULL;
+        LOCK(&wheel_mutex, LOCK_WHEEL);
+        while (wheel_now < target) timer_tick(&expired);
+        UNLOCK(&wheel_mutex);
+    
+        while (expired) {
+            Timer *timer = expired;
+            expired = timer->fire_next;
+            timer->expired(timer);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Start the thread driving the wheel
+ */
+int timer_start(void) {
+    if (pthread_create(&timer_thread, NULL, timer_loop, NULL) != 0) {
+        perror("[SERVER] Timer thread creation error");
+        return -1;
+    }
+    pthread_detach(timer_thread);
+    return 0;
+}
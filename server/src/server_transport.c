@@ -0,0 +1,163 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#include "../server.h"
+#include <sys/epoll.h>
+
+// ===============================
+// TRANSPORT SELECTION
+// ===============================
+
+const Transport *transport = &threads_transport;
+
+static const Transport *const transports[] = {
+    &threads_transport,
+    &epoll_transport,
+    &uring_transport,
+};
+
+/**
+ * Find a transport by its command line name
+ */
+const Transport* transport_by_name(const char *name) {
+    for (size_t i = 0; i < sizeof(transports) / sizeof(transports[0]); i++) {
+        if (strcmp(transports[i]->name, name) == 0) {
+            return transports[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Queue data for a client; the active transport writes it out
+ */
+void client_send(Client *client, const char *data, size_t len) {
+    if (client_enqueue(client, data, len) > 0) {
+        transport->kick(client);
+    }
+}
+
+/**
+ * Queue an event in the client's protocol: the fixed size message for
+ * binary clients, the rendered text otherwise
+ */
+void client_send_event(Client *client, const Response *text, int type, const void *payload, size_t len) {
+    if (client_enqueue_event(client, text, type, payload, len) > 0) {
+        transport->kick(client);
+    }
+}
+
+/**
+ * Let the active transport write a queue that became non-empty
+ */
+void client_kick(Client *client) {
+    transport->kick(client);
+}
+
+/**
+ * Queue a multi-segment response, written with a single sendmsg
+ */
+void client_send_response(Client *client, const Response *r) {
+    if (client_enqueue_response(client, r) > 0) {
+        transport->kick(client);
+    }
+}
+
+// ===============================
+// THREAD-PER-CLIENT TRANSPORT
+// ===============================
+
+static int flush_epoll_fd = -1;
+
+/**
+ * Write right away from the calling thread; whatever the socket
+ * does not accept is left to the flusher thread
+ */
+static void threads_kick(Client *client) {
+    client_flush(client);
+}
+
+/**
+ * Flusher thread: every client socket is registered edge-triggered for
+ * EPOLLOUT, so it wakes up only when a full socket becomes writable again
+ */
+static void *threads_flusher(void *arg) {
+    (void)arg;
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    
+    while (server_running) {
+        int n = epoll_wait(flush_epoll_fd, events, REACTOR_MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("[SERVER] epoll_wait error");
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            client_flush((Client *)events[i].data.ptr);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Blocking accept, one detached thread per socket
+ */
+static int threads_run(int listen_fd) {
+    struct sockaddr_in client_addr;
+    socklen_t client_len = sizeof(client_addr);
+    pthread_t flusher;
+    
+    flush_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (flush_epoll_fd < 0) {
+        perror("[SERVER] epoll_create error");
+        return -1;
+    }
+    if (pthread_create(&flusher, NULL, threads_flusher, NULL) != 0) {
+        perror("[SERVER] Thread creation error");
+        return -1;
+    }
+    pthread_detach(flusher);
+    
+    while (server_running) {
+        int client_socket = accept(listen_fd, 
+                                   (struct sockaddr *)&client_addr, 
+                                   &client_len);
+        
+        if (client_socket < 0) {
+            if (server_running) {
+                perror("[SERVER] Accept error");
+            }
+            continue;
+        }
+        
+        Client *client = accept_client(client_socket, &client_addr, -1);
+        if (!client) continue;
+        
+        struct epoll_event ev;
+        ev.events = EPOLLOUT | EPOLLET;
+        ev.data.ptr = client;
+        if (epoll_ctl(flush_epoll_fd, EPOLL_CTL_ADD, client_socket, &ev) < 0) {
+            perror("[SERVER] epoll_ctl error");
+        }
+
+        if (pthread_create(&client->thread, NULL, handle_client, client) != 0) {
+            perror("[SERVER] Thread creation error");
+            timer_cancel(&client->timer);
+            release_client(client);
+            continue;
+        }
+        pthread_detach(client->thread);
+    }
+    return 0;
+}
+
+const Transport threads_transport = {
+    .name = "threads",
+    .run = threads_run,
+    .kick = threads_kick,
+    .fallback = NULL,
+};
@@ -0,0 +1,549 @@
+/**
+ * LSO Project - Forza 4 
+ * 
+ * Miguel Lopes Pereira - m.lopespereira@studenti.unina.it
+ * Oriol Poblet Roca - o.pobletroca@studenti.unina.it
+ */
+
+#include "../server.h"
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// ===============================
+// IO_URING TRANSPORT
+// ===============================
+
+typedef enum {
+    OP_ACCEPT,
+    OP_RECV,
+    OP_SEND,
+    OP_WAKE
+} UringOpType;
+
+// Per-connection operation, used as the SQE user_data
+typedef struct UringOp {
+    UringOpType type;
+    Client *client;             // NULL once the connection is gone
+    int inflight;               // send: chained SQEs not yet completed
+    OutChunk *orphans;          // send: chunks the kernel may still read after close
+    struct msghdr msgs[URING_SEND_CHAIN];   // send: one header per chained chunk
+} UringOp;
+
+// Per-connection state, indexed by client slot
+typedef struct UringConn {
+    UringOp *recv_op;
+    UringOp *send_op;
+    int dirty;
+    int closing;
+} UringConn;
+
+// Flush request posted to the ring thread by another thread
+typedef struct UringKick {
+    struct UringKick *next;
+    Client *client;
+    int client_id;              // guards against the slot being reused
+} UringKick;
+
+static struct {
+    int fd;
+    unsigned sq_entries;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    unsigned sqe_tail;          // local tail, published on submit
+    unsigned to_submit;
+    struct io_uring_buf_ring *buf_ring;
+    unsigned short buf_tail;
+    char *buf_base;
+    int wake_fd;                // eventfd, signalled when the inbox becomes non-empty
+    uint64_t wake_count;
+    UringKick *inbox;           // lock-free MPSC stack, newest first
+} ring = { .fd = -1, .wake_fd = -1 };
+
+static UringConn *conns;       // indexed by client slot
+static int *dirty;
+static int dirty_count = 0;
+static UringOp accept_op = { .type = OP_ACCEPT };
+static UringOp wake_op = { .type = OP_WAKE };
+static __thread int on_ring_thread = 0;
+
+static int sys_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_uring_enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, ring.fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_uring_register(unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, ring.fd, opcode, arg, nr_args);
+}
+
+/**
+ * Map the rings and check that the kernel has every feature we rely on
+ */
+static int uring_setup(void) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    
+    ring.fd = sys_uring_setup(URING_ENTRIES, &p);
+    if (ring.fd < 0) return -1;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)) return -1;
+    
+    size_t sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    size_t size = sq_size > cq_size ? sq_size : cq_size;
+    
+    char *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ring.fd, IORING_OFF_SQ_RING);
+    if (ptr == MAP_FAILED) return -1;
+    
+    ring.sq_entries = p.sq_entries;
+    ring.sq_head = (unsigned *)(ptr + p.sq_off.head);
+    ring.sq_tail = (unsigned *)(ptr + p.sq_off.tail);
+    ring.sq_mask = (unsigned *)(ptr + p.sq_off.ring_mask);
+    ring.sq_array = (unsigned *)(ptr + p.sq_off.array);
+    ring.cq_head = (unsigned *)(ptr + p.cq_off.head);
+    ring.cq_tail = (unsigned *)(ptr + p.cq_off.tail);
+    ring.cq_mask = (unsigned *)(ptr + p.cq_off.ring_mask);
+    ring.cqes = (struct io_uring_cqe *)(ptr + p.cq_off.cqes);
+    ring.sqe_tail = *ring.sq_tail;
+    
+    ring.sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe),
+                     PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ring.fd, IORING_OFF_SQES);
+    if (ring.sqes == MAP_FAILED) return -1;
+    
+    size_t probe_size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, probe_size);
+    if (!probe) return -1;
+    int ok = sys_uring_register(IORING_REGISTER_PROBE, probe, 256) == 0;
+    int needed[] = { IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SENDMSG, IORING_OP_READ };
+    for (size_t i = 0; ok && i < sizeof(needed) / sizeof(needed[0]); i++) {
+        ok = needed[i] <= probe->last_op && (probe->ops[needed[i]].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(probe);
+    if (!ok) return -1;
+    
+    // Provided buffer rings and multishot accept both appeared in 5.19:
+    // a successful registration means multishot accept is available too
+    ring.buf_ring = mmap(NULL, URING_BUF_COUNT * sizeof(struct io_uring_buf),
+                         PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (ring.buf_ring == MAP_FAILED) return -1;
+    
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (unsigned long)ring.buf_ring;
+    reg.ring_entries = URING_BUF_COUNT;
+    reg.bgid = URING_BUF_GROUP;
+    if (sys_uring_register(IORING_REGISTER_PBUF_RING, &reg, 1) < 0) return -1;
+    
+    ring.buf_base = malloc((size_t)URING_BUF_COUNT * BUFFER_SIZE);
+    if (!ring.buf_base) return -1;
+    return 0;
+}
+
+/**
+ * Give a recv buffer back to the kernel
+ */
+static void uring_recycle(unsigned short bid) {
+    struct io_uring_buf *buf = &ring.buf_ring->bufs[ring.buf_tail & (URING_BUF_COUNT - 1)];
+    buf->addr = (unsigned long)(ring.buf_base + (size_t)bid * BUFFER_SIZE);
+    buf->len = BUFFER_SIZE;
+    buf->bid = bid;
+    ring.buf_tail++;
+    __atomic_store_n(&ring.buf_ring->tail, ring.buf_tail, __ATOMIC_RELEASE);
+}
+
+/**
+ * Publish the queued SQEs and optionally wait for completions
+ */
+static int uring_submit(unsigned wait) {
+    __atomic_store_n(ring.sq_tail, ring.sqe_tail, __ATOMIC_RELEASE);
+    int ret = sys_uring_enter(ring.to_submit, wait, wait ? IORING_ENTER_GETEVENTS : 0);
+    if (ret >= 0) ring.to_submit = 0;
+    return ret;
+}
+
+static unsigned uring_sq_space(void) {
+    return ring.sq_entries - (ring.sqe_tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE));
+}
+
+/**
+ * Get a free SQE, submitting pending ones if the ring is full
+ */
+static struct io_uring_sqe *uring_get_sqe(void) {
+    while (uring_sq_space() == 0) {
+        if (uring_submit(0) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            return NULL;
+        }
+    }
+    unsigned index = ring.sqe_tail & *ring.sq_mask;
+    struct io_uring_sqe *sqe = &ring.sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring.sq_array[index] = index;
+    ring.sqe_tail++;
+    ring.to_submit++;
+    return sqe;
+}
+
+static void uring_arm_accept(int listen_fd) {
+    struct io_uring_sqe *sqe = uring_get_sqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = (unsigned long)&accept_op;
+}
+
+static void uring_arm_recv(UringOp *op) {
+    struct io_uring_sqe *sqe = uring_get_sqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = op->client->socket;
+    sqe->len = BUFFER_SIZE;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUF_GROUP;
+    sqe->user_data = (unsigned long)op;
+}
+
+static void uring_arm_wake(void) {
+    struct io_uring_sqe *sqe = uring_get_sqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = ring.wake_fd;
+    sqe->addr = (unsigned long)&ring.wake_count;
+    sqe->len = sizeof(ring.wake_count);
+    sqe->user_data = (unsigned long)&wake_op;
+}
+
+static void uring_mark_dirty(int slot) {
+    if (!conns[slot].dirty) {
+        conns[slot].dirty = 1;
+        dirty[dirty_count++] = slot;
+    }
+}
+
+/**
+ * Ask the ring thread to flush a client
+ * The ring thread is only woken up when its inbox was empty
+ */
+static void uring_post(Client *client) {
+    UringKick *kick = malloc(sizeof(UringKick));
+    if (!kick) return;
+    kick->client = client;
+    kick->client_id = client->id;
+    
+    UringKick *head = __atomic_load_n(&ring.inbox, __ATOMIC_RELAXED);
+    do {
+        kick->next = head;
+    } while (!__atomic_compare_exchange_n(&ring.inbox, &head, kick, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    if (head == NULL) {
+        uint64_t one = 1;
+        if (write(ring.wake_fd, &one, sizeof(one)) < 0) {
+            perror("[SERVER] eventfd write error");
+        }
+    }
+}
+
+/**
+ * Queued data is submitted at the end of the current batch; other
+ * threads (game workers) go through the inbox
+ */
+static void uring_kick(Client *client) {
+    if (!on_ring_thread) {
+        uring_post(client);
+        return;
+    }
+    int slot = client->slot;
+    if (!conns[slot].closing) {
+        uring_mark_dirty(slot);
+    }
+}
+
+/**
+ * Handle every flush request posted to the ring thread
+ */
+static void uring_on_wake(struct io_uring_cqe *cqe) {
+    if (cqe->res < 0 && cqe->res != -EINTR && cqe->res != -EAGAIN) {
+        errno = -cqe->res;
+        perror("[SERVER] eventfd read error");
+    }
+    
+    UringKick *kick = __atomic_exchange_n(&ring.inbox, NULL, __ATOMIC_ACQUIRE);
+    while (kick) {
+        UringKick *next = kick->next;
+        Client *client = kick->client;
+        if (client->is_connected && client->id == kick->client_id) {
+            uring_kick(client);
+        }
+        free(kick);
+        kick = next;
+    }
+    uring_arm_wake();
+}
+
+/**
+ * Submit the queued chunks of every dirty client as one linked chain
+ * of sendmsg per client, so that they reach the socket in order
+ */
+static void uring_flush_sends(void) {
+    for (int i = 0; i < dirty_count; i++) {
+        Client *client = client_at(dirty[i]);
+        UringConn *conn = &conns[dirty[i]];
+        UringOp *op = conn->send_op;
+        conn->dirty = 0;
+        if (!op || op->inflight > 0) continue;
+        
+        // Only this thread consumes the queue and the chain is pinned:
+        // the chunks stay valid until their completion, whatever is
+        // appended or shed meanwhile
+        int chain;
+        OutChunk *first = outq_pin(&client->out, URING_SEND_CHAIN, &chain);
+        if (chain == 0) continue;
+        // A chain must not be split across two submissions
+        if (uring_sq_space() < (unsigned)chain) uring_submit(0);
+        
+        OutChunk *chunk = first;
+        for (int n = 0; n < chain; n++, chunk = chunk->next) {
+            struct io_uring_sqe *sqe = uring_get_sqe();
+            if (!sqe) break;
+            struct msghdr *msg = &op->msgs[n];
+            memset(msg, 0, sizeof(*msg));
+            msg->msg_iov = &chunk->iov[chunk->iov_first];
+            msg->msg_iovlen = chunk->iov_count - chunk->iov_first;
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->fd = client->socket;
+            sqe->addr = (unsigned long)msg;
+            sqe->len = 1;
+            sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+            sqe->flags = (n < chain - 1) ? IOSQE_IO_LINK : 0;
+            sqe->user_data = (unsigned long)op;
+            op->inflight++;
+        }
+    }
+    dirty_count = 0;
+}
+
+/**
+ * Tear down a connection; operations still owned by the kernel
+ * are detached and freed when their completion arrives
+ */
+static void uring_finish(Client *client) {
+    UringConn *conn = &conns[client->slot];
+    conn->closing = 1;
+    
+    if (conn->recv_op) conn->recv_op->client = NULL;
+    conn->recv_op = NULL;
+    if (conn->send_op) {
+        if (conn->send_op->inflight > 0) {
+            conn->send_op->client = NULL;
+            conn->send_op->orphans = outq_detach(&client->out);
+        } else {
+            free(conn->send_op);
+        }
+    }
+    conn->send_op = NULL;
+    
+    // Wake up a pending recv so the kernel drops its file reference.
+    // Writing stays open: the release still queues replies (leaving the
+    // game) and flushes them when it closes the socket
+    shutdown(client->socket, SHUT_RD);
+    if (client->username[0] == '\0') {
+        printf("[SERVER] Client #%d disconnected during login\n", client->id);
+    }
+    client_disconnect(client);
+}
+
+/**
+ * Stop reading from a client and release it once its queued
+ * replies (e.g. the goodbye message) have been sent
+ */
+static void uring_close(Client *client) {
+    int slot = client->slot;
+    UringConn *conn = &conns[slot];
+    conn->closing = 1;
+    if (conn->recv_op) conn->recv_op->client = NULL;
+    conn->recv_op = NULL;
+    shutdown(client->socket, SHUT_RD);
+    
+    if (client->out.head || conn->send_op->inflight > 0) uring_mark_dirty(slot);
+    else uring_finish(client);
+}
+
+static void uring_on_accept(int listen_fd, struct io_uring_cqe *cqe) {
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        uring_arm_accept(listen_fd);
+    }
+    if (cqe->res < 0) {
+        errno = -cqe->res;
+        perror("[SERVER] Accept error");
+        return;
+    }
+    
+    int client_socket = cqe->res;
+    struct sockaddr_in client_addr;
+    socklen_t client_len = sizeof(client_addr);
+    memset(&client_addr, 0, sizeof(client_addr));
+    getpeername(client_socket, (struct sockaddr *)&client_addr, &client_len);
+    
+    Client *client = accept_client(client_socket, &client_addr, -1);
+    if (!client) return;
+    
+    UringConn *conn = &conns[client->slot];
+    memset(conn, 0, sizeof(*conn));
+    conn->recv_op = calloc(1, sizeof(UringOp));
+    conn->send_op = calloc(1, sizeof(UringOp));
+    if (!conn->recv_op || !conn->send_op) {
+        free(conn->recv_op);
+        free(conn->send_op);
+        conn->recv_op = conn->send_op = NULL;
+        conn->closing = 1;
+        client_disconnect(client);
+        return;
+    }
+    conn->recv_op->type = OP_RECV;
+    conn->recv_op->client = client;
+    conn->send_op->type = OP_SEND;
+    conn->send_op->client = client;
+    client_welcome(client);
+    uring_arm_recv(conn->recv_op);
+}
+
+static void uring_on_recv(UringOp *op, struct io_uring_cqe *cqe) {
+    int has_buffer = cqe->flags & IORING_CQE_F_BUFFER;
+    unsigned short bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+    Client *client = op->client;
+    
+    if (!client) {
+        if (has_buffer) uring_recycle(bid);
+        free(op);
+        return;
+    }
+    
+    if (cqe->res == -ENOBUFS || cqe->res == -EINTR) {
+        uring_arm_recv(op);
+        return;
+    }
+    
+    int close_it = cqe->res <= 0;
+    if (cqe->res > 0 && has_buffer) {
+        const char *data = ring.buf_base + (size_t)bid * BUFFER_SIZE;
+        size_t left = cqe->res;
+        while (left > 0 && !close_it) {
+            size_t n = linebuf_append(&client->in, data, left);
+            data += n;
+            left -= n;
+            close_it = handle_input(client) < 0;
+        }
+    }
+    if (has_buffer) uring_recycle(bid);
+    
+    if (close_it) {
+        conns[client->slot].recv_op = NULL;
+        free(op);
+        uring_close(client);
+    } else {
+        uring_arm_recv(op);
+    }
+}
+
+static void uring_on_send(UringOp *op, struct io_uring_cqe *cqe) {
+    Client *client = op->client;
+    op->inflight--;
+    if (!client) {
+        if (op->inflight == 0) {
+            outq_free_chunks(op->orphans);
+            free(op);
+        }
+        return;
+    }
+    
+    if (cqe->res > 0) {
+        outq_consume(&client->out, cqe->res);
+    } else if (cqe->res != -ECANCELED && cqe->res != -EINTR && cqe->res != -EAGAIN) {
+        uring_finish(client);
+        return;
+    }
+    
+    if (op->inflight > 0) return;
+    
+    // Whole chain completed: resubmit whatever is left (short write,
+    // cancelled links, or data queued meanwhile)
+    outq_unpin(&client->out);
+    int slot = client->slot;
+    if (client->out.head) uring_mark_dirty(slot);
+    else if (conns[slot].closing) uring_finish(client);
+}
+
+/**
+ * Event loop of the io_uring model: multishot accept, recv into
+ * kernel-selected buffers, and one submission for every batch of sends
+ */
+int uring_run(int listen_fd) {
+    if (uring_setup() < 0) {
+        if (ring.fd >= 0) close(ring.fd);
+        ring.fd = -1;
+        return -1;
+    }
+    ring.wake_fd = eventfd(0, EFD_CLOEXEC);
+    if (ring.wake_fd < 0) {
+        perror("[SERVER] eventfd error");
+        close(ring.fd);
+        ring.fd = -1;
+        return -1;
+    }
+    conns = calloc(config.max_clients, sizeof(UringConn));
+    dirty = calloc(config.max_clients, sizeof(int));
+    if (!conns || !dirty) {
+        perror("[SERVER] io_uring allocation error");
+        exit(EXIT_FAILURE);
+    }
+    on_ring_thread = 1;
+    
+    for (unsigned short i = 0; i < URING_BUF_COUNT; i++) {
+        uring_recycle(i);
+    }
+    uring_arm_accept(listen_fd);
+    uring_arm_wake();
+    
+    while (server_running) {
+        uring_flush_sends();
+        if (uring_submit(1) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            perror("[SERVER] io_uring_enter error");
+            break;
+        }
+        
+        unsigned head = *ring.cq_head;
+        unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            struct io_uring_cqe cqe = ring.cqes[head & *ring.cq_mask];
+            head++;
+            __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+            
+            UringOp *op = (UringOp *)(unsigned long)cqe.user_data;
+            switch (op->type) {
+                case OP_ACCEPT: uring_on_accept(listen_fd, &cqe); break;
+                case OP_RECV:   uring_on_recv(op, &cqe); break;
+                case OP_SEND:   uring_on_send(op, &cqe); break;
+                case OP_WAKE:   uring_on_wake(&cqe); break;
+            }
+            tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        }
+    }
+    close(ring.wake_fd);
+    close(ring.fd);
+    return 0;
+}
+
+const Transport uring_transport = {
+    .name = "uring",
+    .run = uring_run,
+    .kick = uring_kick,
+    .fallback = &epoll_transport,
+};
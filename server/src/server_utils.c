@@ -11,31 +11,143 @@
 // UTILITY FUNCTIONS
 // ===============================
 
+// Slot + 1 of the client with a given id, at id & client_mask (0: none).
+// Ids only grow, so the id stored in the slot tells whether the entry is
+// still current: a released or reused slot never matches
+static int *client_index;
+static int client_mask;
+
+// Username hash index, chained through the clients themselves. Login and
+// release change it under names_mutex; lookups walk it without locking,
+// which is safe since clients are never freed. A walk can still miss: a
+// client unlinked and registered again under another name meanwhile
+// moves to another chain, taking the reader with it. A miss is therefore
+// confirmed under the lock
+static Client **name_index;
+static unsigned name_mask;
+static pthread_mutex_t names_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Client locks, by slot: a client's lock keeps it from being released
+// (and its slot reused) while it is held. Accepts are serialized by
+// ids_mutex, which guards client_count and the id index writers
+typedef struct ClientLock {
+    pthread_mutex_t lock;
+} __attribute__((aligned(CACHE_LINE))) ClientLock;
+
+static ClientLock client_locks[CLIENT_LOCK_SHARDS];
+static pthread_mutex_t ids_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+#define BROADCAST_BATCH 256
+
+static int power_of_two_above(int n) {
+    int size = 1;
+    while (size < n) size <<= 1;
+    return size;
+}
+
+static pthread_mutex_t *client_lock(Client *client) {
+    return &client_locks[client->slot % CLIENT_LOCK_SHARDS].lock;
+}
+
+/**
+ * Size the id and username indexes for the client limit: the id index
+ * gets twice as many entries as clients, so that a free one is always
+ * close for a new id
+ */
+int client_indexes_init(int max_clients) {
+    for (int i = 0; i < CLIENT_LOCK_SHARDS; i++) {
+        pthread_mutex_init(&client_locks[i].lock, NULL);
+    }
+
+    int index_size = power_of_two_above(2 * max_clients);
+    int name_size = power_of_two_above(max_clients);
+    client_index = calloc(index_size, sizeof(int));
+    name_index = calloc(name_size, sizeof(Client *));
+    if (!client_index || !name_index) return -1;
+    client_mask = index_size - 1;
+    name_mask = name_size - 1;
+    return 0;
+}
+
 /**
  * Send a message to a client
  */
 void send_to_client(int client_id, const char *message) {
-    pthread_mutex_lock(&clients_mutex);
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (clients[i].is_connected && clients[i].id == client_id) {
-            send(clients[i].socket, message, strlen(message), 0);
-            break;
-        }
+    Response r;
+    response_init(&r);
+    response_string(&r, message);
+    send_response_to_client(client_id, &r);
+}
+
+/**
+ * Send a multi-segment response to a client
+ */
+void send_response_to_client(int client_id, const Response *r) {
+    send_event_to_client(client_id, r, MSG_TEXT, NULL, 0);
+}
+
+/**
+ * Send an event to a client in its protocol
+ * The socket is written after the client's lock is released
+ */
+void send_event_to_client(int client_id, const Response *text, int type, const void *payload, size_t len) {
+    int kick = 0;
+    Client *target = lock_client_by_id(client_id);
+    if (target) {
+        kick = client_enqueue_event(target, text, type, payload, len) > 0;
+        unlock_client(target);
     }
-    pthread_mutex_unlock(&clients_mutex);
+    
+    if (kick) client_kick(target);
 }
 
 /**
  * Send a message to all connected clients except one
  */
 void broadcast_except(int exclude_id, const char *message) {
-    pthread_mutex_lock(&clients_mutex);
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (clients[i].is_connected && clients[i].id != exclude_id) {
-            send(clients[i].socket, message, strlen(message), 0);
+    broadcast_event_except(exclude_id, message, MSG_TEXT, NULL, 0);
+}
+
+/**
+ * Send an event to all connected clients except one, each in its protocol
+ * The message is copied once and every queue references it; the client
+ * locks only cover linking it into the queues, transports are kicked
+ * (and write the sockets) after they are released
+ */
+void broadcast_event_except(int exclude_id, const char *message, int type, const void *payload, size_t len) {
+    SharedBuffer *buf = shared_buffer_create(message, strlen(message));
+    if (!buf) return;
+    
+    Response r;
+    response_init(&r);
+    response_shared(&r, buf);
+    r.kind = OUT_NOTICE;
+    
+    // Shard by shard, in batches, so that a lock is released (and the
+    // sockets written) every BROADCAST_BATCH queued messages
+    Client *kick[BROADCAST_BATCH];
+    int capacity = table_capacity(&client_table);
+    for (int shard = 0; shard < CLIENT_LOCK_SHARDS; shard++) {
+        int i = shard;
+        while (i < capacity) {
+            int kick_count = 0;
+            LOCK(&client_locks[shard].lock, LOCK_CLIENT);
+            for (; i < capacity && kick_count < BROADCAST_BATCH; i += CLIENT_LOCK_SHARDS) {
+                Client *client = client_at(i);
+                if (client->is_connected && client->id != exclude_id) {
+                    if (client_enqueue_event(client, &r, type, payload, len) > 0) {
+                        kick[kick_count++] = client;
+                    }
+                }
+            }
+            UNLOCK(&client_locks[shard].lock);
+            
+            for (int k = 0; k < kick_count; k++) {
+                client_kick(kick[k]);
+            }
         }
     }
-    pthread_mutex_unlock(&clients_mutex);
+    shared_buffer_release(buf);
 }
 
 /**
@@ -46,21 +158,217 @@ void broadcast_all(const char *message) {
 }
 
 /**
- * Get client by ID
+ * Create a listening socket on the given port
+ * SO_REUSEPORT lets several reactors bind their own listener to the same port
+ */
+int open_listener(int port) {
+    struct sockaddr_in server_addr;
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        perror("[SERVER] Socket creation error");
+        return -1;
+    }
+    
+    int opt = 1;
+    if (setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0 ||
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        perror("[SERVER] setsockopt error");
+        close(listen_fd);
+        return -1;
+    }
+    
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = INADDR_ANY;
+    server_addr.sin_port = htons(port);
+    
+    if (bind(listen_fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+        perror("[SERVER] Binding error");
+        close(listen_fd);
+        return -1;
+    }
+    
+    if (listen(listen_fd, SOMAXCONN) < 0) {
+        perror("[SERVER] Listen error");
+        close(listen_fd);
+        return -1;
+    }
+    return listen_fd;
+}
+
+/**
+ * Assign a free slot to a freshly accepted socket
+ * Returns NULL (and closes the socket) when the server is full
+ */
+Client* accept_client(int client_socket, struct sockaddr_in *client_addr, int reactor_id) {
+    int slot = table_alloc(&client_table);
+    if (slot < 0) {
+        char *full_msg = "Server full. Try again later.\n";
+        send(client_socket, full_msg, strlen(full_msg), 0);
+        close(client_socket);
+        return NULL;
+    }
+    
+    Client *client = client_at(slot);
+    LOCK(&ids_mutex, LOCK_IDS);
+    LOCK(client_lock(client), LOCK_CLIENT);
+    // Skip the ids whose index entry still belongs to a connected client
+    for (;;) {
+        client_count++;
+        int entry = client_index[client_count & client_mask];
+        if (entry == 0 || !client_at(entry - 1)->is_connected ||
+            ((client_at(entry - 1)->id ^ client_count) & client_mask)) {
+            break;
+        }
+    }
+    client->id = client_count;
+    client->socket = client_socket;
+    __atomic_store_n(&client->is_connected, 1, __ATOMIC_RELEASE);
+    client->current_game_id = -1;
+    client->address = *client_addr;
+    client->reactor_id = reactor_id;
+    client->proto = PROTO_TEXT;
+    client->tasks = NULL;
+    client->backlog = NULL;
+    client->pending = 0;
+    client->hangup = 0;
+    client->join_count = 0;
+    client->opening_game_id = -1;
+    client->last_active = timer_now();
+    timer_arm(&client->timer, TIMER_TICKS(LOGIN_TIMEOUT_MS), client->id);
+    linebuf_reset(&client->in);
+    strcpy(client->username, "");
+    __atomic_store_n(&client_index[client_count & client_mask], slot + 1, __ATOMIC_RELEASE);
+    UNLOCK(client_lock(client));
+    UNLOCK(&ids_mutex);
+    return client;
+}
+
+/**
+ * Close the socket of a client and give its slot back
+ */
+void release_client(Client *client) {
+    LOCK(client_lock(client), LOCK_CLIENT);
+    client_close_socket(client);
+    client->is_connected = 0;
+    UNLOCK(client_lock(client));
+    table_free(&client_table, client->slot);
+}
+
+/**
+ * Get client by ID, in constant time and without locking
+ * The result is only guaranteed to stay valid under the client's lock,
+ * see lock_client_by_id()
  */
 Client* get_client_by_id(int client_id) {
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (clients[i].is_connected && clients[i].id == client_id) {
-            return &clients[i];
+    if (client_id <= 0) return NULL;
+    int entry = __atomic_load_n(&client_index[client_id & client_mask], __ATOMIC_ACQUIRE);
+    if (entry == 0) return NULL;
+    
+    Client *client = client_at(entry - 1);
+    if (!__atomic_load_n(&client->is_connected, __ATOMIC_ACQUIRE) ||
+        __atomic_load_n(&client->id, __ATOMIC_RELAXED) != client_id) {
+        return NULL;
+    }
+    return client;
+}
+
+/**
+ * Get a client by ID with its lock held, so that it cannot be released
+ * until unlock_client()
+ * Returns NULL (and holds nothing) if there is no such client
+ */
+Client* lock_client_by_id(int client_id) {
+    Client *client = get_client_by_id(client_id);
+    if (!client) return NULL;
+    
+    // Released and maybe reused between the lookup and the lock
+    LOCK(client_lock(client), LOCK_CLIENT);
+    if (!client->is_connected || client->id != client_id) {
+        UNLOCK(client_lock(client));
+        return NULL;
+    }
+    return client;
+}
+
+void unlock_client(Client *client) {
+    UNLOCK(client_lock(client));
+}
+
+static unsigned name_hash(const char *name) {
+    unsigned hash = 2166136261u;
+    while (*name) {
+        hash = (hash ^ (unsigned char)*name++) * 16777619u;
+    }
+    return hash & name_mask;
+}
+
+/**
+ * Give a client its username, unless a connected client already has it
+ * Returns -1 when the name is taken
+ */
+int client_register_name(Client *client, const char *name) {
+    char username[MAX_USERNAME];
+    strncpy(username, name, MAX_USERNAME - 1);
+    username[MAX_USERNAME - 1] = '\0';
+    Client **bucket = &name_index[name_hash(username)];
+    
+    LOCK(&names_mutex, LOCK_NAMES);
+    for (Client *c = *bucket; c; c = c->name_next) {
+        if (strcmp(c->username, username) == 0) {
+            UNLOCK(&names_mutex);
+            return -1;
         }
     }
-    return NULL;
+    strcpy(client->username, username);
+    client->name_next = *bucket;
+    __atomic_store_n(bucket, client, __ATOMIC_RELEASE);
+    UNLOCK(&names_mutex);
+    return 0;
+}
+
+/**
+ * Free the username of a client being released
+ */
+void client_unregister_name(Client *client) {
+    if (client->username[0] == '\0') return;
+    
+    LOCK(&names_mutex, LOCK_NAMES);
+    Client **link = &name_index[name_hash(client->username)];
+    while (*link && *link != client) {
+        link = &(*link)->name_next;
+    }
+    if (*link) __atomic_store_n(link, client->name_next, __ATOMIC_RELEASE);
+    UNLOCK(&names_mutex);
+}
+
+/**
+ * Get a logged in client by username, in constant time and without
+ * locking when it is found
+ */
+Client* get_client_by_username(const char *name) {
+    Client **bucket = &name_index[name_hash(name)];
+    Client *c = __atomic_load_n(bucket, __ATOMIC_ACQUIRE);
+    while (c) {
+        if (__atomic_load_n(&c->is_connected, __ATOMIC_ACQUIRE) && strcmp(c->username, name) == 0) {
+            return c;
+        }
+        c = __atomic_load_n(&c->name_next, __ATOMIC_ACQUIRE);
+    }
+    
+    LOCK(&names_mutex, LOCK_NAMES);
+    for (c = *bucket; c; c = c->name_next) {
+        if (c->is_connected && strcmp(c->username, name) == 0) break;
+    }
+    UNLOCK(&names_mutex);
+    return c;
 }
 
 /**
  * Get username by client ID
  */
 const char* get_username(int client_id) {
+    if (client_id == BOT_ID) return BOT_NAME;
     Client *c = get_client_by_id(client_id);
     return c ? c->username : "Unknown";
 }